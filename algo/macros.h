@@ -11,3 +11,10 @@ using Iter_value = typename std::iterator_traits<T>::value_type;
 template <typename T>
 using Iter_diff = typename std::iterator_traits<T>::difference_type;
 
+
+// hint that addr will be read soon, a no-op where the compiler has no builtin
+#if defined(__GNUC__) || defined(__clang__)
+#define SAL_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define SAL_PREFETCH(addr) ((void)0)
+#endif
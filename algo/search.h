@@ -4,14 +4,50 @@ contact: johnsonzhong@hotmail.ca | johnsonzhong.me
 finding elements inside sets
 
 bin_search(begin, end, key) -> iterator to the element comparing equal to key, else end
+bin_search(begin, end, keys_begin, keys_end, out) -> position of each key (size if absent) to out, searches interleaved
+Eytzinger<T, Cmp> e(sorted)	sorted keys in breadth first order for repeated searches, branchless and prefetched
+e.lower_bound(key), e.upper_bound(key), e.equal_range(key), e.find(key) -> 0 based ranks in sorted order, n if none
+Learned_index<T> li(sorted, eps)	integer keys, piecewise linear model within eps positions, radix table over segments
+li.lower_bound(key), li.upper_bound(key), li.find(key) -> ranks as above; li.bytes() memory beyond the keys
 
 intersection(set of sets)   -> set of values contained in all the sets
+intersect_sorted(begin1, end1, begin2, end2, out)	sorted sets: merges (SSE2 for 32 bit ints) or gallops when sizes differ
+union_sorted(...), difference_sorted(...)	same arguments, results written to out in order
+intersect_sorted(set of sorted sets) -> vector, smallest first, bitmaps for dense integer ids
 
 select(begin, end, i)       -> ith smallest value from begin to end
+select(begin, end, i, cmp)     Floyd-Rivest with three way partitions, median of medians fallback, O(n) worst case
+nth_select(begin, nth, end, cmp)	like std::nth_element
+top_k(begin, end, k, cmp)   -> end of the k smallest, sorted at the front (like std::partial_sort)
+multi_select(begin, end, ranks, cmp)	nth_select for every 0 based rank at once, ex. percentiles
+
+streaming, one pass and bounded memory, mergeable across threads and shards
+Kll_sketch<T, Cmp> sketch(k)	quantile sketch keeping ~3k items, rank error about 1.7/k
+sketch.insert(v), sketch.merge(other)
+sketch.quantile(q)          -> item at fraction q of the sorted stream
+sketch.rank(v)              -> fraction of the stream not greater than v
+Top_k<T, Cmp> top(k)        k greatest under cmp in a heap; top.push(v), top.merge(other), top.sorted()
 
 min_max(begin, end)			-> pair with minimum as first and maximum as second of a sequence
+argmin(begin, end), argmax(begin, end) -> iterator to the first minimum or maximum
+sum(begin, end)             -> sum, 64 bit for integers
+primitive keys in arrays and vectors use SSE2 or AVX2 kernels picked at run time, no -mavx2 needed
+par_min_max, par_argmin, par_argmax, par_sum(begin, end, threads = 0) split large ranges over threads
 
 sub_match(sentence, word)   -> iterator to the starting element of a match of word in sentence, else end
+String_searcher ss(word)	word compiled once for lots of text: memchr, SIMD rare byte pair scan, Horspool, KMP
+ss.find(text, from = 0)     -> offset of the first match at or after from, text.size() if none
+ss.find(begin, end)         -> pointer to the first match in a buffer, end if none
+ss.find_all(text)           -> offsets of every match; ss.find_all(begin, end, f) calls f(pointer) for each
+ss.count(text), ss.count(begin, end) -> number of matches
+Stream_searcher stream(word)	text in chunks, matches spanning chunks included
+stream.feed(begin, end, f)  -> f(offset from the start of the stream) for each match
+for_each_chunk(path or FILE*, f, chunk_bytes) -> f(begin, end) over a file, mmapped where possible
+search_file(path, word or Aho_corasick, f)	-> f(offset) or f(Match) for each match in a file; count_file(path, word)
+Aho_corasick ac(words)		automaton over many words, every match of all of them in one pass
+ac.find_all(text)           -> vector of Match{pos, pattern}, overlapping matches included
+ac.count(text)              -> occurrences of each word
+ac.scan(begin, end, state, f) -> f(Match) for each match, returns the state to scan the next chunk from
 
 lc_subseq_len(sequence, sequence) -> returns length of longest common subsequence (extraction of characters)
 lc_subseq(sequence, sequence)     -> returns longest common subsequence
@@ -21,10 +57,21 @@ class: Suffix_array efficient data structure for finding common substrings, expo
 lc_substr(string, string)   -> string of longest common substring
 Suffix_array(string, string)-> construct for reuse
 sa.lc_substr()              -> calls are cheap after construction
+Suffix_array<Sequence> sa(text)	SA-IS in O(n) with Kasai's lcp, 32 bit indices below 2^32 symbols
+Suffix_array<Sequence> sa(text, threads) -> the same arrays by parallel prefix doubling (0 threads for all cores)
+sa.suffix(i), sa.common_prefix_len(i) -> start of the ith smallest suffix, its common prefix with the next
+sa.occurrance(word)         -> start of every suffix beginning with word
+sa.bytes(), sa.build_bytes() -> memory kept, and the most held during construction (8 and 12 bytes per symbol)
 */
 
 #pragma once
 #include "search/element_select.h"
+#include "search/static_search.h"
+#include "search/learned_index.h"
+#include "search/sorted_sets.h"
+#include "search/quantile_sketch.h"
 #include "search/longest_common.h"
 #include "search/string_search.h"
+#include "search/aho_corasick.h"
+#include "search/stream_search.h"
 #include "search/Suffix_array.h"
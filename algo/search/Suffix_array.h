@@ -1,131 +1,534 @@
 #pragma once
-#include <algorithm>    // sort
+#include <algorithm>    // sort, unique, lower_bound, fill, copy
+#include <cstdint>      // uint32_t, uint64_t
 #include <iomanip>  // setw
 #include <iostream>
+#include <limits>
+#include <string>
+#include <thread>       // hardware_concurrency
+#include <type_traits>  // integral_constant, is_integral
+#include <utility>      // pair, swap
 #include <vector>
+#include "../sort/distribution_sorts.h" // Cnt_impl::scatter, on_threads
 
 namespace sal {
 
+// suffix array construction by induced sorting (SA-IS, Nong, Zhang and Chan), O(n) time
+// suffixes are typed S (smaller than the next suffix) or L (larger); the S ones preceded by an L (LMS) are sorted
+// first, which sorts the rest by induction in two sweeps; sorting the LMS substrings themselves recurses on a
+// string of their names at most half as long
+// indices are 32 bit when the text allows it, halving the arrays and what the build touches
+namespace Suffix_impl {
+
+// bytes held by a build's buffers, current and at most
+struct Memory {
+    size_t now {0}, peak {0};
+    void add(size_t bytes) { now += bytes; peak = std::max(peak, now); }
+    void sub(size_t bytes) { now -= bytes; }
+};
+// a buffer's bytes against the build for as long as it's alive
+template <typename T>
+class Buffer {
+    std::vector<T> v;
+    Memory& mem;
+public:
+    Buffer(size_t n, Memory& m, T init = T{}) : v(n, init), mem(m) { mem.add(n * sizeof(T)); }
+    ~Buffer() { mem.sub(v.size() * sizeof(T)); }
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+    T& operator[](size_t i) { return v[i]; }
+    const T& operator[](size_t i) const { return v[i]; }
+    T* data() { return v.data(); }
+    const T* data() const { return v.data(); }
+    size_t size() const { return v.size(); }
+    // drops the buffer early, ex. before recursing
+    void release() { mem.sub(v.size() * sizeof(T)); std::vector<T>().swap(v); }
+};
+
+// S/L types, a bit per position
+class Types {
+    std::vector<uint64_t> bits;
+    Memory& mem;
+public:
+    Types(size_t n, Memory& m) : bits(n / 64 + 1), mem(m) { mem.add(bits.size() * sizeof(uint64_t)); }
+    ~Types() { mem.sub(bits.size() * sizeof(uint64_t)); }
+    bool s(size_t i) const { return bits[i / 64] >> (i % 64) & 1; }
+    void set_s(size_t i) { bits[i / 64] |= uint64_t{1} << (i % 64); }
+    bool lms(size_t i) const { return i > 0 && s(i) && !s(i - 1); }
+};
+
+// symbols of a text as indices into the buckets
+template <typename I, typename Sequence>
+struct Bytes {
+    const Sequence* s;
+    I operator[](I i) const { return static_cast<unsigned char>((*s)[i]); }
+};
+
+template <typename I, typename Text>
+void induce(Text s, I n, const Types& t, const I* lms, I m,
+            const Buffer<I>& l_start, const Buffer<I>& s_start, Buffer<I>& bucket, I* sa) {
+    const I empty {std::numeric_limits<I>::max()};
+    std::fill(sa, sa + n, empty);
+    // LMS suffixes at the front of their buckets' S parts, in the given order
+    std::copy(s_start.data(), s_start.data() + s_start.size(), bucket.data());
+    for (I j = 0; j < m; ++j) sa[bucket[s[lms[j]]]++] = lms[j];
+    // L suffixes left to right from the front of each bucket, the last suffix first (the empty one precedes it)
+    std::copy(l_start.data(), l_start.data() + l_start.size(), bucket.data());
+    sa[bucket[s[n - 1]]++] = n - 1;
+    for (I i = 0; i < n; ++i) {
+        const I v {sa[i]};
+        if (v != empty && v > 0 && !t.s(v - 1)) sa[bucket[s[v - 1]]++] = v - 1;
+    }
+    // S suffixes right to left from the back of each bucket, replacing the LMS placeholders
+    std::copy(l_start.data(), l_start.data() + l_start.size(), bucket.data());
+    for (I i = n; i-- > 0;) {
+        const I v {sa[i]};
+        if (v != empty && v > 0 && t.s(v - 1)) sa[--bucket[s[v - 1] + 1]] = v - 1;
+    }
+}
+
+// suffix array of s[0, n) with symbols in [0, k) into sa
+template <typename I, typename Text>
+void sais(Text s, I n, I k, I* sa, Memory& mem) {
+    if (n == 0) return;
+    if (n == 1) { sa[0] = 0; return; }
+    if (n == 2) { sa[0] = s[0] < s[1] ? 0 : 1; sa[1] = 1 - sa[0]; return; }
+
+    // the last suffix is L, being larger than the empty one
+    Types t {n, mem};
+    for (I i = n - 1; i-- > 0;)
+        if (s[i] < s[i + 1] || (s[i] == s[i + 1] && t.s(i + 1))) t.set_s(i);
+
+    // bucket c holds suffixes starting with c, L ones in front of S ones
+    Buffer<I> l_start {static_cast<size_t>(k) + 1, mem}, s_start {static_cast<size_t>(k) + 1, mem}, bucket {static_cast<size_t>(k) + 1, mem};
+    for (I i = 0; i < n; ++i) ++(t.s(i) ? l_start[s[i] + 1] : s_start[s[i]]);
+    for (I c = 0; c < k; ++c) {
+        s_start[c] += l_start[c];
+        l_start[c + 1] += s_start[c];
+    }
+
+    I m {0};
+    for (I i = 1; i < n; ++i) m += t.lms(i);
+    Buffer<I> lms {m, mem};
+    for (I i = 1, j = 0; i < n; ++i) if (t.lms(i)) lms[j++] = i;
+    induce(s, n, t, lms.data(), m, l_start, s_start, bucket, sa);
+    if (m == 0) return;
+
+    // LMS substrings in sorted order; equal neighbours get the same name
+    Buffer<I> sorted {m, mem};
+    for (I i = 0, j = 0; i < n; ++i) if (t.lms(sa[i])) sorted[j++] = sa[i];
+    // LMS positions are at least 2 apart, so a name can be kept at half the position
+    Buffer<I> names {n / 2 + 1, mem};
+    auto end_of = [&](I p) {
+        for (++p; p < n && !t.lms(p); ++p) {}
+        return p;
+    };
+    I name {0};
+    names[sorted[0] / 2] = 0;
+    for (I i = 1; i < m; ++i) {
+        I l {sorted[i - 1]}, r {sorted[i]};
+        const I end_l {end_of(l)}, end_r {end_of(r)};
+        bool same {end_l - l == end_r - r};
+        for (; same && l < end_l; ++l, ++r) same = s[l] == s[r];
+        // the substrings include the next LMS position, unless the text ran out
+        same = same && end_l < n && end_r < n && s[end_l] == s[end_r];
+        if (!same) ++name;
+        names[sorted[i] / 2] = name;
+    }
+    Buffer<I> reduced {m, mem};
+    for (I j = 0; j < m; ++j) reduced[j] = names[lms[j] / 2];
+    names.release();
+
+    // distinct names sort the reduced string directly, else recurse
+    Buffer<I> reduced_sa {m, mem};
+    if (name + 1 == m) for (I j = 0; j < m; ++j) reduced_sa[reduced[j]] = j;
+    else sais<I, const I*>(reduced.data(), m, name + 1, reduced_sa.data(), mem);
+    reduced.release();
+    for (I j = 0; j < m; ++j) sorted[j] = lms[reduced_sa[j]];
+    reduced_sa.release();
+    induce(s, n, t, sorted.data(), m, l_start, s_start, bucket, sa);
+}
+
+// longest common prefix of each suffix and the next in sorted order (Kasai et al.), 0 for the last
+// going through suffixes by position, the common prefix shrinks by at most 1 each step
+template <typename I, typename Sequence>
+void kasai(const Sequence& s, const std::vector<I>& sa, std::vector<I>& lcp, Memory& mem) {
+    const I n = sa.size();
+    lcp.assign(n, 0);
+    mem.add(n * sizeof(I));
+    Buffer<I> rank {n, mem};
+    for (I i = 0; i < n; ++i) rank[sa[i]] = i;
+    for (I p = 0, h = 0; p < n; ++p) {
+        const I r {rank[p]};
+        if (r + 1 == n) { lcp[r] = 0; h = 0; continue; }
+        const I q {sa[r + 1]};
+        while (p + h < n && q + h < n && s[p + h] == s[q + h]) ++h;
+        lcp[r] = h;
+        if (h) --h;
+    }
+}
+
+// symbols other than bytes are renamed to their rank among the distinct values
+template <typename I, typename Sequence>
+void build(const Sequence& s, std::vector<I>& sa, std::vector<I>& lcp, Memory& mem, std::true_type) {
+    const I n = s.size();
+    sais<I>(Bytes<I, Sequence>{&s}, n, I{256}, sa.data(), mem);
+    kasai(s, sa, lcp, mem);
+}
+template <typename I, typename Sequence>
+void build(const Sequence& s, std::vector<I>& sa, std::vector<I>& lcp, Memory& mem, std::false_type) {
+    using T = typename Sequence::value_type;
+    const I n = s.size();
+    std::vector<T> values(s.begin(), s.end());
+    mem.add(n * sizeof(T));
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    {
+        Buffer<I> text {n, mem};
+        for (I i = 0; i < n; ++i) text[i] = std::lower_bound(values.begin(), values.end(), s[i]) - values.begin();
+        sais<I, const I*>(text.data(), n, static_cast<I>(values.size()), sa.data(), mem);
+    }
+    std::vector<T>().swap(values);
+    mem.sub(n * sizeof(T));
+    kasai(s, sa, lcp, mem);
+}
+
+// parallel construction: prefix doubling (Manber and Myers) where a round only sorts the groups of suffixes
+// still tied on their first h symbols, by the rank of the suffix h further on
+// groups of at least parallel_cutoff are radix sorted by all threads together, smaller ones are shared out
+// whole, a thread each; the lcp is Kasai's with a slice of text positions per thread
+// rounds go up to the log of the longest repeat, O(n log n) work against SA-IS's O(n), but the first round
+// sorts on up to 64 bits of symbols and later ones only touch what's still tied; the arrays come out the same
+constexpr size_t radix_bits {11};
+
+template <typename I>
+struct Record {
+    uint64_t key;
+    I idx;
+};
+
+// f(first, last) over [0, n) in an even slice per thread
+template <typename F>
+void on_slices(size_t n, unsigned threads, F f) {
+    Cnt_impl::on_threads(threads, [&](unsigned t) { f(n * t / threads, n * (t + 1) / threads); });
+}
+
+// whole groups shared out to threads by their total size, f(t, first, last) over indices into groups
+template <typename I, typename F>
+void on_groups(const std::vector<std::pair<I, I>>& groups, unsigned threads, F f) {
+    if (groups.empty()) return;
+    std::vector<size_t> sums(groups.size() + 1);
+    for (size_t g = 0; g < groups.size(); ++g) sums[g + 1] = sums[g] + (groups[g].second - groups[g].first);
+    threads = Cnt_impl::pick_threads(threads, sums.back());
+    Cnt_impl::on_threads(threads, [&](unsigned t) {
+        auto at = [&](unsigned u) {
+            return std::lower_bound(sums.begin(), sums.end() - 1, sums.back() * u / threads) - sums.begin();
+        };
+        f(t, at(t), at(t + 1));
+    });
+}
+
+// stable LSD sort of n records on the key bits in varying, every pass shared by the threads
+template <typename I>
+void radix_sort(Record<I>* a, Record<I>* buf, size_t n, uint64_t varying, unsigned threads) {
+    constexpr uint64_t digit {(uint64_t{1} << radix_bits) - 1};
+    std::vector<size_t> counts, bounds;
+    Record<I>* in {a};
+    Record<I>* out {buf};
+    for (unsigned shift = 0; shift < 64 && varying >> shift; shift += radix_bits) {
+        if (!(varying >> shift & digit)) continue;
+        Cnt_impl::scatter(in, n, out, [shift](const Record<I>& r) { return static_cast<size_t>(r.key >> shift & digit); },
+                          digit + 1, counts, bounds, Cnt_impl::pick_threads(threads, n));
+        std::swap(in, out);
+    }
+    if (in != a) on_slices(n, Cnt_impl::pick_threads(threads, n), [&](size_t first, size_t last) {
+        std::copy(in + first, in + last, a + first);
+    });
+}
+
+// a sorted group [b, e) split where key(j) changes: each suffix's rank becomes the position its new group
+// starts at, and groups still tied (more than one suffix) are added to ties
+template <typename I, typename Key>
+void relabel(const I* sa, I* rank, I b, I e, Key key, std::vector<std::pair<I, I>>& ties) {
+    I head {b};
+    for (I j = b; j < e; ++j) {
+        if (j != head && key(j) != key(j - 1)) {
+            if (j - head > 1) ties.emplace_back(head, j);
+            head = j;
+        }
+        rank[sa[j]] = head;
+    }
+    if (e - head > 1) ties.emplace_back(head, e);
+}
+// each thread takes a slice, starting from the head of the group it begins inside of;
+// a group is added by the thread its head falls to, which follows it past the slice
+template <typename I, typename Key>
+void par_relabel(const I* sa, I* rank, I b, I e, Key key, std::vector<std::pair<I, I>>& ties, unsigned threads) {
+    threads = Cnt_impl::pick_threads(threads, e - b);
+    std::vector<std::vector<std::pair<I, I>>> found(threads);
+    const size_t len = e - b;
+    Cnt_impl::on_threads(threads, [&](unsigned t) {
+        const I first = b + len * t / threads, last = b + len * (t + 1) / threads;
+        I head {first};
+        while (head > b && key(head) == key(head - 1)) --head;
+        for (I j = first; j < last; ++j) {
+            if (j != head && key(j) != key(j - 1)) {
+                if (head >= first && j - head > 1) found[t].emplace_back(head, j);
+                head = j;
+            }
+            rank[sa[j]] = head;
+        }
+        if (head < first || first == last) return;
+        I end {last};
+        while (end < e && key(end) == key(end - 1)) ++end;
+        if (end - head > 1) found[t].emplace_back(head, end);
+    });
+    for (const auto& f : found) ties.insert(ties.end(), f.begin(), f.end());
+}
+
+// symbol(i) in [1, k] for i < n, 0 standing for past the end
+template <typename I, typename Symbol>
+void par_double(I n, I k, Symbol symbol, std::vector<I>& sa, Memory& mem, unsigned threads) {
+    if (n == 0) return;
+    threads = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    // the first round sorts on as many symbols as fit in 64 bits
+    const unsigned bits {Cnt_impl::log2(k) + 1}, per_key {64 / bits};
+    const uint64_t mask {bits * per_key == 64 ? ~uint64_t{0} : (uint64_t{1} << bits * per_key) - 1};
+    Buffer<I> rank {n, mem};
+    std::vector<std::pair<I, I>> ties;
+    {
+        Buffer<Record<I>> recs {n, mem}, buf {n, mem};
+        const unsigned th {Cnt_impl::pick_threads(threads, n)};
+        on_slices(n, th, [&](size_t first, size_t last) {
+            uint64_t key {0};
+            for (size_t j = 0; j < per_key; ++j) key = key << bits | (first + j < n ? symbol(first + j) : 0);
+            for (size_t i = first; i < last; ++i) {
+                recs[i] = {key & mask, static_cast<I>(i)};
+                key = key << bits | (i + per_key < n ? symbol(i + per_key) : 0);
+            }
+        });
+        radix_sort(recs.data(), buf.data(), n, mask, threads);
+        buf.release();
+        on_slices(n, th, [&](size_t first, size_t last) { for (size_t j = first; j < last; ++j) sa[j] = recs[j].idx; });
+        par_relabel(sa.data(), rank.data(), I{0}, n, [&recs](I j) { return recs[j].key; }, ties, threads);
+    }
+
+    Buffer<I> key {n, mem};
+    std::vector<std::vector<std::pair<I, I>>> found(threads);
+    std::vector<std::pair<I, I>> small, large;
+    for (size_t h = per_key; !ties.empty(); h *= 2) {
+        small.clear();
+        large.clear();
+        for (const auto& g : ties) (g.second - g.first < Cnt_impl::parallel_cutoff ? small : large).push_back(g);
+        ties.clear();
+        auto rank_after = [&](I i) -> I { return i + h < n ? rank[i + h] + 1 : 0; };
+        auto key_at = [&key](I j) { return key[j]; };
+
+        // every key before any rank changes
+        on_groups(small, threads, [&](unsigned, size_t first, size_t last) {
+            for (size_t g = first; g < last; ++g)
+                for (I j = small[g].first; j < small[g].second; ++j) key[j] = rank_after(sa[j]);
+        });
+        for (const auto& g : large)
+            on_slices(g.second - g.first, Cnt_impl::pick_threads(threads, g.second - g.first), [&](size_t first, size_t last) {
+                for (I j = g.first + first; j < g.first + last; ++j) key[j] = rank_after(sa[j]);
+            });
+
+        on_groups(small, threads, [&](unsigned t, size_t first, size_t last) {
+            std::vector<std::pair<I, I>> pairs;
+            for (size_t g = first; g < last; ++g) {
+                const I b {small[g].first}, e {small[g].second};
+                pairs.clear();
+                for (I j = b; j < e; ++j) pairs.emplace_back(key[j], sa[j]);
+                std::sort(pairs.begin(), pairs.end());
+                for (I j = b; j < e; ++j) { key[j] = pairs[j - b].first; sa[j] = pairs[j - b].second; }
+                relabel(sa.data(), rank.data(), b, e, key_at, found[t]);
+            }
+        });
+        for (auto& f : found) { ties.insert(ties.end(), f.begin(), f.end()); f.clear(); }
+
+        for (const auto& g : large) {
+            const size_t len = g.second - g.first;
+            const unsigned th {Cnt_impl::pick_threads(threads, len)};
+            Buffer<Record<I>> recs {len, mem}, buf {len, mem};
+            on_slices(len, th, [&](size_t first, size_t last) {
+                for (size_t j = first; j < last; ++j) recs[j] = {key[g.first + j], sa[g.first + j]};
+            });
+            radix_sort(recs.data(), buf.data(), len, (uint64_t{2} << Cnt_impl::log2(n)) - 1, threads);
+            on_slices(len, th, [&](size_t first, size_t last) {
+                for (size_t j = first; j < last; ++j) { key[g.first + j] = static_cast<I>(recs[j].key); sa[g.first + j] = recs[j].idx; }
+            });
+            par_relabel(sa.data(), rank.data(), g.first, g.second, key_at, ties, threads);
+        }
+    }
+}
+
+// Kasai's with the next suffix in sorted order looked up by position, so slices of positions run independently
+// (each starts its common prefix from 0)
+template <typename I, typename Sequence>
+void par_kasai(const Sequence& s, const std::vector<I>& sa, std::vector<I>& lcp, Memory& mem, unsigned threads) {
+    const I n = sa.size();
+    const I none {std::numeric_limits<I>::max()};
+    threads = Cnt_impl::pick_threads(threads, n);
+    lcp.resize(n);
+    mem.add(n * sizeof(I));
+    // first the suffix after each position's in sorted order, then the common prefix with it
+    Buffer<I> plcp {n, mem};
+    on_slices(n, threads, [&](size_t first, size_t last) {
+        for (size_t j = first; j < last; ++j) plcp[sa[j]] = j + 1 < n ? sa[j + 1] : none;
+    });
+    on_slices(n, threads, [&](size_t first, size_t last) {
+        I h {0};
+        for (I p = first; p < last; ++p) {
+            const I q {plcp[p]};
+            if (q == none) { plcp[p] = 0; h = 0; continue; }
+            while (p + h < n && q + h < n && s[p + h] == s[q + h]) ++h;
+            plcp[p] = h;
+            if (h) --h;
+        }
+    });
+    on_slices(n, threads, [&](size_t first, size_t last) {
+        for (size_t j = first; j < last; ++j) lcp[j] = plcp[sa[j]];
+    });
+}
+
+// bytes renamed to [1, k] in order, only the ones in the text
+template <typename I, typename Sequence>
+void par_build(const Sequence& s, std::vector<I>& sa, std::vector<I>& lcp, Memory& mem, unsigned threads, std::true_type) {
+    const I n = s.size();
+    const unsigned th {Cnt_impl::pick_threads(threads, n)};
+    std::vector<std::vector<char>> seen(th, std::vector<char>(256));
+    Cnt_impl::on_threads(th, [&](unsigned t) {
+        for (size_t i = n * t / th, last = n * (t + 1) / th; i < last; ++i) seen[t][static_cast<unsigned char>(s[i])] = 1;
+    });
+    I names[256];
+    I k {0};
+    for (unsigned c = 0; c < 256; ++c) {
+        bool used {false};
+        for (const auto& sn : seen) used = used || sn[c];
+        names[c] = used ? ++k : 0;
+    }
+    par_double(n, k, [&](size_t i) { return names[static_cast<unsigned char>(s[i])]; }, sa, mem, threads);
+    par_kasai(s, sa, lcp, mem, threads);
+}
+template <typename I, typename Sequence>
+void par_build(const Sequence& s, std::vector<I>& sa, std::vector<I>& lcp, Memory& mem, unsigned threads, std::false_type) {
+    using T = typename Sequence::value_type;
+    const I n = s.size();
+    std::vector<T> values(s.begin(), s.end());
+    mem.add(n * sizeof(T));
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    {
+        Buffer<I> text {n, mem};
+        on_slices(n, Cnt_impl::pick_threads(threads, n), [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) text[i] = std::lower_bound(values.begin(), values.end(), s[i]) - values.begin() + 1;
+        });
+        par_double(n, static_cast<I>(values.size()), [&text](size_t i) { return text[i]; }, sa, mem, threads);
+    }
+    std::vector<T>().swap(values);
+    mem.sub(n * sizeof(T));
+    par_kasai(s, sa, lcp, mem, threads);
+}
+
+}   // end namespace Suffix_impl
+
 // longest common substring using suffix arrays
-// might consider implementing SAIS construction for almost sublinear performance!
 template <typename Sequence = std::string>
 class Suffix_array {
     // assume the original sequence won't be modified...
     const Sequence& s;
     // sa[i] gives starting index of ith smallest suffix
     // longest common prefix (lcp) lcp[i] gives length of longest common prefix of suffix starting at sa[i] and sa[i+1]
-    std::vector<size_t> sa, rank, lcp;
+    // one pair of arrays is used: 32 bit below 2^32 - 1 suffixes, else 64 bit
+    std::vector<uint32_t> sa32, lcp32;
+    std::vector<uint64_t> sa64, lcp64;
+    bool wide;
+    size_t peak_bytes;
 
-    void build() {
+    template <typename I>
+    void build(std::vector<I>& sa, std::vector<I>& lcp) {
+        Suffix_impl::Memory mem;
         sa.resize(s.size());
-        rank.resize(s.size());
-        std::vector<size_t> temp(s.size());
-        // initialize sa[] and rank[]
-        // initial rank is just the character value (1-gram)
-        for (size_t i = 0; i < s.size(); ++i) {
-            sa[i] = i;
-            rank[i] = s[i];
-        }
-
-        // gap is length of m-gram / 2; start with 2-grams
-        for (size_t gap = 1;; gap *= 2) {
-            // sort m-grams
-            Suffix_cmp suffix_cmp(*this, gap);
-            std::sort(sa.begin(), sa.begin() + s.size(), suffix_cmp);
-        
-            // compute lexicographic rank by comparing against neighbour
-            for (size_t i = 0; i < s.size() - 1; ++i) 
-                temp[i + 1] = temp[i] + suffix_cmp(sa[i], sa[i+1]);
-                // suffix_cmp is 0 if they're the same, else 1
-
-            // temp holds rank relative to position, map to per m-gram
-            for (size_t i = 0; i < s.size(); ++i)
-                rank[sa[i]] = temp[i];
-
-            // top rank being s.size() - 1 means no gram have same rank, done
-            if (temp[s.size() - 1] == s.size() - 1) break;
-        }
-    }
-
-    void build_lcp(){
-        lcp.resize(s.size());
-        for (size_t suffix = 0, common_c = 0; suffix < s.size(); ++suffix)
-            // going through lexicographic rank of each suffix
-            if (rank[suffix] != s.size() - 1) {
-                // next is starting location of the next lexicographical suffix
-                for (size_t next = sa[rank[suffix] + 1]; s[suffix + common_c] == s[next + common_c];) ++common_c;
-                lcp[rank[suffix]] = common_c;
-                // next common character length is atleast last - 1
-                if (common_c) --common_c; 
-            }
-
-        // after building lcp, no longer need rank
-        rank.clear();
-        rank.shrink_to_fit();
+        mem.add(s.size() * sizeof(I));
+        Suffix_impl::build(s, sa, lcp, mem, Byte_symbols{});
+        peak_bytes = mem.peak;
     }
-
-    size_t common_start(size_t i, size_t j){
-        size_t common {0};
-        while (s[i++] == s[j++]) ++common;
-        return common;
+    template <typename I>
+    void par_build(std::vector<I>& sa, std::vector<I>& lcp, unsigned threads) {
+        Suffix_impl::Memory mem;
+        sa.resize(s.size());
+        mem.add(s.size() * sizeof(I));
+        Suffix_impl::par_build(s, sa, lcp, mem, threads, Byte_symbols{});
+        peak_bytes = mem.peak;
     }
 
+    // bytes order as unsigned, whatever the signedness of char
+    using T = typename Sequence::value_type;
+    using Byte_symbols = std::integral_constant<bool, sizeof(T) == 1 && std::is_integral<T>::value>;
+    static bool less(const T& a, const T& b, std::true_type) {return static_cast<unsigned char>(a) < static_cast<unsigned char>(b);}
+    static bool less(const T& a, const T& b, std::false_type) {return a < b;}
+    static bool less(const T& a, const T& b) {return less(a, b, Byte_symbols{});}
 
-    class Suffix_cmp {
-        Suffix_array<Sequence>& sa;
-        size_t gap;
-    public:
-        Suffix_cmp(Suffix_array& s, size_t g) : sa(s), gap{g} {}
-        bool operator()(size_t i, size_t j) {
-            if (sa.rank[i] != sa.rank[j])
-                return sa.rank[i] < sa.rank[j];
-            i += gap;   // every m-gram is split into 2 known parts, + gap is 2nd part
-            j += gap;
-            // index i > j implies i is at the end, meaning it is shorter
-            return (i < sa.s.size() && j < sa.s.size())? sa.rank[i] < sa.rank[j] : i > j;
-        }
-    };
-    friend class Suffix_cmp;
+    size_t sa_at(size_t i) const {return wide ? sa64[i] : sa32[i];}
+    size_t lcp_at(size_t i) const {return wide ? lcp64[i] : lcp32[i];}
 
 public:
-    Suffix_array(const Sequence& text) : s(text) {build(); build_lcp();}
+    Suffix_array(const Sequence& text) : s(text), wide{text.size() >= std::numeric_limits<uint32_t>::max()} {
+        if (wide) build(sa64, lcp64);
+        else build(sa32, lcp32);
+    }
+    // parallel prefix doubling on threads (0 for all of them), the same arrays as above
+    // about as fast as SA-IS on one thread, but peaks at 40 bytes per symbol rather than 12 (32 bit indices)
+    Suffix_array(const Sequence& text, unsigned threads) : s(text), wide{text.size() >= std::numeric_limits<uint32_t>::max()} {
+        if (wide) par_build(sa64, lcp64, threads);
+        else par_build(sa32, lcp32, threads);
+    }
 
-    size_t size() const {return sa.size();}
+    size_t size() const {return s.size();}
     // reference to original text
     const Sequence& text() const {return s;}
     // starting index of ith smallest suffix
-    size_t suffix(size_t ith_suffix) const {return sa[ith_suffix];}
-    // length of common prefix for ith smallest suffix and ith-1 suffix
-    size_t common_prefix_len(size_t ith_suffix) const {return lcp[ith_suffix];}
+    size_t suffix(size_t ith_suffix) const {return sa_at(ith_suffix);}
+    // length of common prefix for ith smallest suffix and ith+1 suffix
+    size_t common_prefix_len(size_t ith_suffix) const {return lcp_at(ith_suffix);}
+    // bytes held by the arrays, and the most the construction held at once (arrays included, text not)
+    size_t bytes() const {return wide ? (sa64.size() + lcp64.size()) * 8 : (sa32.size() + lcp32.size()) * 4;}
+    size_t build_bytes() const {return peak_bytes;}
     // print out all suffixes in lexicographic order for learning
     void print() const {
-        for (size_t i = 0; i < sa.size(); ++i) {
-            std::cout << std::setw(5) << sa[i] << '-' << lcp[i] << ": "  << Sequence(s.begin() + sa[i], s.end()) << std::endl;
+        for (size_t i = 0; i < size(); ++i) {
+            std::cout << std::setw(5) << sa_at(i) << '-' << lcp_at(i) << ": "  << Sequence(s.begin() + sa_at(i), s.end()) << std::endl;
         }
     }
 
-    // number of suffixes starting target
+    // starting index of every suffix starting with target
     std::vector<size_t> occurrance(const Sequence& target) const {
-        auto begin = std::lower_bound(sa.begin(), sa.end(), target,
-            [&](size_t i, const Sequence& t){
-                for (size_t ii = 0; ii < t.size(); ++ii) {
-                    // overflow for original text; shorter text is smaller
-                    if (i+ii >= s.size()) return true;
-                    if (s[i+ii] < t[ii]) return true;
-                    if (s[i+ii] > t[ii]) return false;
-                    // else check the next character
-                }
-                // on tie, return current pointer (property of lower_bound)
-                return false; });
-
-        if (begin == sa.end()) return {};
+        // -1 if suffix i is ordered before target, 0 if it starts with it, else 1
+        auto cmp = [&](size_t i) {
+            for (size_t ii = 0; ii < target.size(); ++ii) {
+                // overflow for original text; shorter text is smaller
+                if (i+ii >= s.size()) return -1;
+                if (less(s[i+ii], target[ii])) return -1;
+                if (less(target[ii], s[i+ii])) return 1;
+                // else check the next character
+            }
+            return 0;
+        };
+        size_t lo {0}, hi {size()};
+        while (lo < hi) {
+            const size_t mid {lo + (hi - lo) / 2};
+            if (cmp(sa_at(mid)) < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == size() || cmp(sa_at(lo)) != 0) return {};
 
         std::vector<size_t> occurance_list;
-        size_t suffix = begin-sa.begin();
+        size_t suffix = lo;
         // substrings are adjacent, so just have to check common prefix length exceeds target length
-        while (lcp[suffix] >= target.size()) {occurance_list.push_back(sa[suffix]); ++suffix;}
+        while (suffix + 1 < size() && lcp_at(suffix) >= target.size()) {occurance_list.push_back(sa_at(suffix)); ++suffix;}
         // last suffix covered by previous suffix's lcp
-        occurance_list.push_back(sa[suffix]);
+        occurance_list.push_back(sa_at(suffix));
         return occurance_list;
     }
 };
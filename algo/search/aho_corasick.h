@@ -0,0 +1,146 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>		// uint32_t
+#include <queue>
+#include <stdexcept>	// length_error
+#include <string>
+#include <vector>
+
+namespace sal {
+
+// every occurrence of many patterns in one pass over the text, O(n + matches) however many patterns
+// Aho-Corasick: a trie of the patterns where every state also knows where to go on any byte,
+// following the failure links (longest proper suffix that's also a trie path) at build time
+// transitions are one dense table lookup; bytes no pattern uses share a column,
+// so thousands of ASCII keywords need tens of columns rather than 256
+// matching is bytewise, empty patterns never match; overlapping and repeated patterns are all reported
+class Aho_corasick {
+public:
+    struct Match {
+        size_t pos;			// offset of the match's first byte
+        uint32_t pattern;	// index of the pattern in the list it was built from
+    };
+
+private:
+    static constexpr uint32_t emits {1u << 31};	// flag on a transition whose target ends some pattern
+
+    std::vector<uint32_t> delta;	// row of state s starts at s * columns; entries are target rows, | emits
+    uint32_t column[256];			// byte -> column
+    uint32_t columns {1};
+    std::vector<uint32_t> out_begin, out_ids;	// patterns ending exactly at state s: out_ids[out_begin[s], out_begin[s+1])
+    std::vector<uint32_t> dict;		// nearest state on the failure chain that ends a pattern, 0 if none
+    std::vector<uint32_t> lens;		// pattern lengths
+
+    template <typename F>
+    void report(uint32_t state, size_t end, F& f) const {
+        for (; state; state = dict[state])
+            for (uint32_t i = out_begin[state]; i < out_begin[state + 1]; ++i)
+                f(Match{end - lens[out_ids[i]], out_ids[i]});
+    }
+
+public:
+    // patterns is any sequence of byte strings, ex. vector<string>
+    template <typename Sequence>
+    explicit Aho_corasick(const Sequence& patterns) {
+        // columns: 0 for bytes no pattern has, then one for each byte that appears
+        for (auto& c : column) c = 0;
+        for (const auto& p : patterns)
+            for (unsigned char c : p) if (!column[c]) column[c] = columns++;
+
+        // trie, children in a dense row per state (the same table becomes the automaton)
+        std::vector<std::vector<uint32_t>> ends(1);
+        delta.assign(columns, 0);
+        uint32_t states {1};
+        for (const auto& p : patterns) {
+            uint32_t s {0};
+            for (unsigned char c : p) {
+                const size_t at {s * columns + column[c]};
+                if (!delta[at]) {
+                    if ((uint64_t{states} + 1) * columns >= emits) throw std::length_error("Aho_corasick: too many states");
+                    delta[at] = states++;
+                    delta.resize(size_t{states} * columns, 0);
+                    ends.emplace_back();
+                }
+                s = delta[at];
+            }
+            lens.push_back(static_cast<uint32_t>(p.size()));
+            if (s) ends[s].push_back(static_cast<uint32_t>(lens.size() - 1));
+        }
+
+        out_begin.assign(states + 1, 0);
+        for (uint32_t s = 0; s < states; ++s) out_begin[s + 1] = out_begin[s] + ends[s].size();
+        for (const auto& e : ends) out_ids.insert(out_ids.end(), e.begin(), e.end());
+
+        // breadth first so a state's failure target is finished before it; missing transitions borrow the
+        // failure target's, which makes every row complete
+        std::vector<uint32_t> fail(states, 0);
+        dict.assign(states, 0);
+        std::queue<uint32_t> q;
+        for (uint32_t c = 0; c < columns; ++c) if (delta[c]) q.push(delta[c]);
+        while (!q.empty()) {
+            const uint32_t s {q.front()};
+            q.pop();
+            const uint32_t f {fail[s]};
+            dict[s] = out_begin[f] != out_begin[f + 1] ? f : dict[f];
+            for (uint32_t c = 0; c < columns; ++c) {
+                uint32_t& next = delta[s * columns + c];
+                if (next) {
+                    fail[next] = delta[f * columns + c];
+                    // the root's row is already complete, and a child's failure target is never the child
+                    if (fail[next] == next) fail[next] = 0;
+                    q.push(next);
+                }
+                else next = delta[f * columns + c];
+            }
+        }
+        // targets as row offsets flagged if they end any pattern, so scanning is a load and a mask per byte
+        for (auto& next : delta) {
+            const bool ends_any {out_begin[next] != out_begin[next + 1] || dict[next]};
+            next = next * columns | (ends_any ? emits : 0);
+        }
+    }
+
+    // scanning state, carried from one chunk of a stream to the next
+    struct State {
+        uint32_t row {0};
+        size_t offset {0};	// bytes scanned so far, match positions are relative to the stream's start
+    };
+
+    // f(Match) for every match ending in [begin, end), in order of where they end; returns the state after
+    // matches spanning chunks are found since the state remembers the partial match
+    template <typename F>
+    State scan(const char* begin, const char* end, State st, F f) const {
+        uint32_t row {st.row};
+        const uint32_t* table {delta.data()};
+        for (const char* p = begin; p != end; ++p) {
+            const uint32_t next {table[row + column[static_cast<unsigned char>(*p)]]};
+            row = next & ~emits;
+            if (next & emits) report(row / columns, st.offset + (p - begin) + 1, f);
+        }
+        st.row = row;
+        st.offset += end - begin;
+        return st;
+    }
+    template <typename F>
+    void scan(const std::string& text, F f) const { scan(text.data(), text.data() + text.size(), State{}, f); }
+
+    std::vector<Match> find_all(const std::string& text) const {
+        std::vector<Match> matches;
+        scan(text, [&matches](const Match& m) { matches.push_back(m); });
+        return matches;
+    }
+    // occurrences of each pattern
+    std::vector<size_t> count(const std::string& text) const {
+        std::vector<size_t> counts(lens.size());
+        scan(text, [&counts](const Match& m) { ++counts[m.pattern]; });
+        return counts;
+    }
+
+    size_t patterns() const { return lens.size(); }
+    size_t states() const { return dict.size(); }
+    size_t bytes() const {
+        return (delta.size() + out_begin.size() + out_ids.size() + dict.size() + lens.size()) * sizeof(uint32_t);
+    }
+};
+
+}
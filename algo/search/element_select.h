@@ -1,8 +1,15 @@
 #pragma once
+#include <algorithm>		// min, max, sort, unique, lower_bound
+#include <cmath>			// log, exp, sqrt
+#include <functional>		// less
 #include <iterator>			// distance
+#include <type_traits>		// integral_constant, is_same
 #include <unordered_set>
 #include <unordered_map>
-#include "../sort/partition.h"
+#include <vector>
+#include "../sort/partition.h"	// block_partition, partition_less
+#include "../sort/pdq_sort.h"	// insertion_sort, pdq_sort
+#include "simd_reduce.h"		// min_max, find and sum kernels
 #include "../macros.h"      // Iter_value
 
 namespace sal {
@@ -39,6 +46,45 @@ Iter bin_search(Iter begin, Iter end, const T& key) {
 template <typename Sequence, typename T>
 typename Sequence::iterator bin_search(const Sequence& c, const T& key) { return bin_search(c.begin(), c.end(), key); }
 
+// many keys against the same sorted range, ex. the probe side of a join
+// one search at a time waits on each probe's cache miss in turn; a group of searches is instead advanced
+// in lockstep, every search in the group prefetching its next probe before any of them compares again,
+// so the group's misses overlap; all searches over the same range take the same number of steps
+namespace Batch_impl {
+constexpr size_t group {16};	// searches in flight, about the misses a core can have outstanding
+}
+// writes the position (offset from begin) of an element equal to each key, or the size if there's none,
+// returns out past the last one written; keys need only be forward iterators
+template <typename Iter, typename Key_iter, typename Out>
+Out bin_search(Iter begin, Iter end, Key_iter keys_begin, Key_iter keys_end, Out out) {
+    const size_t n = end - begin;
+    Key_iter keys[Batch_impl::group];
+    size_t lo[Batch_impl::group];
+    while (keys_begin != keys_end) {
+        size_t m {0};
+        for (; m < Batch_impl::group && keys_begin != keys_end; ++m, ++keys_begin) {
+            keys[m] = keys_begin;
+            lo[m] = 0;
+        }
+        if (n == 0) {
+            for (size_t j = 0; j < m; ++j) *out++ = n;
+            continue;
+        }
+        // branchless lower bound, lo is left on the last element less than the key (or 0)
+        for (size_t len = n; len > 1;) {
+            const size_t half {len / 2};
+            for (size_t j = 0; j < m; ++j) lo[j] += begin[lo[j] + half] < *keys[j] ? half : 0;
+            len -= half;
+            for (size_t j = 0; j < m; ++j) SAL_PREFETCH(&*(begin + lo[j] + len / 2));
+        }
+        for (size_t j = 0; j < m; ++j) {
+            const size_t pos {lo[j] + (begin[lo[j]] < *keys[j])};
+            *out++ = pos < n && begin[pos] == *keys[j] ? pos : n;
+        }
+    }
+    return out;
+}
+
 // count doesn't matter (won't tell repeats)
 template <typename Sequence_set>
 unordered_set<typename Sequence_set::value_type::value_type> intersection(const Sequence_set& seq_set) {
@@ -68,45 +114,232 @@ unordered_set<typename Sequence_set::value_type::value_type> intersection(const
 }
 
 
+namespace Select_impl {
+
+constexpr long small_size {16};			// insertion sort what's left
+constexpr long sample_threshold {600};	// Floyd and Rivest's cutoff for pivoting on a sample
+constexpr int bad_limit {4};			// lopsided partitions allowed before median of medians takes over
+
+template <typename Iter, typename Cmp>
+void nth(Iter begin, Iter k, Iter end, Cmp cmp, int bad);
+
+// [begin, result) less than pivot; SIMD block partition for primitive keys under <
+template <typename Iter, typename Cmp>
+Iter partition_below(Iter begin, Iter end, const Iter_value<Iter>& pivot, Cmp cmp, std::false_type) {
+    return Partition_impl::block_partition(begin, end, [&](const Iter_value<Iter>& v) { return cmp(v, pivot); });
+}
+template <typename Iter, typename Cmp>
+Iter partition_below(Iter begin, Iter end, const Iter_value<Iter>& pivot, Cmp, std::true_type) {
+    return Partition_impl::partition_less(begin, end, pivot, std::true_type{});
+}
+
+// three way split around pivot (taken from the range) narrowed to the side holding k
+// the keys equal to pivot are only split off when k is past the less side, true if k landed among them
+template <typename Iter, typename Cmp>
+bool narrow(Iter& begin, Iter k, Iter& end, const Iter_value<Iter>& pivot, Cmp cmp) {
+    using T = Iter_value<Iter>;
+    Iter lt {partition_below(begin, end, pivot, cmp,
+        std::integral_constant<bool, Partition_impl::Use_simd<Iter>::value && std::is_same<Cmp, std::less<T>>::value>{})};
+    if (k < lt) { end = lt; return false; }
+    Iter le {Partition_impl::block_partition(lt, end, [&](const T& v) { return !cmp(pivot, v); })};
+    if (k < le) return true;
+    begin = le;
+    return false;
+}
+
+// median of medians of 5, at least 3/10 of the range falls on each side so every round is linear
+template <typename Iter, typename Cmp>
+Iter_value<Iter> median_of_medians(Iter begin, Iter end, Cmp cmp) {
+    const long n {end - begin};
+    Iter medians {begin};
+    for (long g = 0; g < n; g += 5) {
+        Iter group {begin + g}, group_end {begin + std::min(g + 5, n)};
+        Pdq_impl::insertion_sort(group, group_end, cmp);
+        std::iter_swap(medians++, group + (group_end - group) / 2);
+    }
+    Iter mid {begin + (medians - begin) / 2};
+    nth(begin, mid, medians, cmp, 0);
+    return *mid;
+}
+
+// Floyd and Rivest: select k's relative rank inside a window of about n^(2/3) elements around k,
+// so the pivot lands just beside the answer and the partition keeps a sliver instead of about half
+// the window is first filled with a strided sample of the whole range, since sorted runs, organ pipes
+// and what earlier partitions left behind make the elements already next to k a poor sample
+template <typename Iter, typename Cmp>
+Iter_value<Iter> sample_pivot(Iter begin, Iter k, Iter end, Cmp cmp, int bad) {
+    const long n {end - begin};
+    if (n > sample_threshold) {
+        const long i {k - begin};
+        const double z {std::log(static_cast<double>(n))};
+        const double s {0.5 * std::exp(2 * z / 3)};
+        const double sd {0.5 * std::sqrt(z * s * (n - s) / n) * (i < n / 2 ? -1 : 1)};
+        const long lo {std::max(0L, static_cast<long>(i - i * s / n + sd))};
+        const long hi {std::min(n, static_cast<long>(i + (n - i) * s / n + sd) + 1)};
+        const long step {n / (hi - lo)};
+        for (long j = 0; j < hi - lo; ++j) std::iter_swap(begin + lo + j, begin + j * step);
+        nth(begin + lo, k, begin + hi, cmp, bad);
+    }
+    return *k;
+}
+
+template <typename Iter, typename Cmp>
+void nth(Iter begin, Iter k, Iter end, Cmp cmp, int bad) {
+    while (end - begin > small_size) {
+        const long n {end - begin};
+        if (narrow(begin, k, end, bad > 0 ? sample_pivot(begin, k, end, cmp, bad) : median_of_medians(begin, end, cmp), cmp))
+            return;
+        if (bad > 0 && end - begin > n / 4 * 3) --bad;
+    }
+    Pdq_impl::insertion_sort(begin, end, cmp);
+}
+
+template <typename Iter, typename Cmp>
+void multi(Iter begin, Iter sub_begin, Iter sub_end, const size_t* first, const size_t* last, Cmp cmp) {
+    while (first != last) {
+        const size_t* mid {first + (last - first) / 2};
+        Iter k {begin + *mid};
+        nth(sub_begin, k, sub_end, cmp, bad_limit);
+        multi(begin, sub_begin, k, first, mid, cmp);
+        sub_begin = k + 1;
+        first = mid + 1;
+    }
+}
+
+}	// end namespace Select_impl
+
+// arranges [begin, end) so nth holds what it would if sorted, nothing after it is less and nothing
+// before it is greater, like std::nth_element
+// Floyd-Rivest sampling select with three way partitions (equal keys end it early), O(n) worst case:
+// after a few partitions that keep over 3/4 of the range the pivot comes from median of medians
+template <typename Iter, typename Cmp>
+void nth_select(Iter begin, Iter nth, Iter end, Cmp cmp) {
+    if (nth != end) Select_impl::nth(begin, nth, end, cmp, Select_impl::bad_limit);
+}
+template <typename Iter>
+void nth_select(Iter begin, Iter nth, Iter end) { nth_select(begin, nth, end, std::less<Iter_value<Iter>>()); }
+
 // select ith smallest element (1 is smallest) important algorithm used in many other places
 // enables bypassing sorting (nlgn usually) when the exact order of elements don't matter in a range (ex. top 100)
-// implements quickselect, with average O(n) performance
-template <typename Iter>
-Iter select(Iter begin, Iter end, size_t i) {
-    if (end-begin < (int)i) return end;
-    while (true) {
-        if (end - begin == 1) return begin;
-        Iter pivot {sal::partition(begin, end)};  
-        size_t rank = pivot - begin + 1; // the order of pivot
-
-        if (i == rank) return pivot;
-        if (i < rank) end = pivot;   // look in the left partition
-        else {begin = pivot + 1; i -= rank; } // look in the right
-    }
+template <typename Iter, typename Cmp>
+Iter select(Iter begin, Iter end, size_t i, Cmp cmp) {
+    if (i == 0 || static_cast<size_t>(end - begin) < i) return end;
+    nth_select(begin, begin + (i - 1), end, cmp);
+    return begin + (i - 1);
 }
+template <typename Iter>
+Iter select(Iter begin, Iter end, size_t i) { return select(begin, end, i, std::less<Iter_value<Iter>>()); }
 template <typename Sequence>
 typename Sequence::iterator select(Sequence& c, size_t i) { return select(c.begin(), c.end(), i); }
 
+// k smallest in order at the front, the rest after in no order, like std::partial_sort; O(n + klgk)
+// returns the end of the k
+template <typename Iter, typename Cmp>
+Iter top_k(Iter begin, Iter end, size_t k, Cmp cmp) {
+    Iter mid {begin + std::min<size_t>(k, end - begin)};
+    nth_select(begin, mid, end, cmp);
+    pdq_sort(begin, mid, cmp);
+    return mid;
+}
+template <typename Iter>
+Iter top_k(Iter begin, Iter end, size_t k) { return top_k(begin, end, k, std::less<Iter_value<Iter>>()); }
 
-// find minimum and maximum in 3*ceil(n/2) comparisons
+// every position in ranks (0 based from begin) gets what nth_select would put there, ex. the 50th, 90th
+// and 99th percentiles at once; each select only runs between the ranks already placed around it
+template <typename Iter, typename Cmp>
+void multi_select(Iter begin, Iter end, std::vector<size_t> ranks, Cmp cmp) {
+    std::sort(ranks.begin(), ranks.end());
+    ranks.erase(std::lower_bound(ranks.begin(), ranks.end(), static_cast<size_t>(end - begin)), ranks.end());
+    ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+    Select_impl::multi(begin, begin, end, ranks.data(), ranks.data() + ranks.size(), cmp);
+}
 template <typename Iter>
-std::pair<Iter_value<Iter>, Iter_value<Iter>> min_max(Iter begin, Iter end) {
-    using T = Iter_value<Iter>;
-    T min = begin[0];
-    T max = begin[0];
-    size_t size = end - begin;
-    size_t start_index = (size & 1)? 1 : 0; // start at 0 if even, else 1
-    for (size_t i = start_index; i < size; i += 2) {
-        if (begin[i] < begin[i+1]) {
-            if (begin[i] < min) min = begin[i];
-            if (begin[i+1] > max) max = begin[i+1];
-        }
-        else {
-            if (begin[i] > max) max = begin[i];
-            if (begin[i+1] < min) min = begin[i+1];
-        }
+void multi_select(Iter begin, Iter end, const std::vector<size_t>& ranks) {
+    multi_select(begin, end, ranks, std::less<Iter_value<Iter>>());
+}
+
+
+// min and max in one pass, T{} for both if empty
+// contiguous primitive keys (pointers, vector iterators) use SIMD kernels picked at run time,
+// anything else is compared in pairs, 3*ceil(n/2) comparisons
+template <typename Iter>
+std::pair<Iter_value<Iter>, Iter_value<Iter>> min_max(Iter begin, Iter end) { return Reduce_impl::min_max(begin, end); }
+
+namespace Select_impl {
+template <typename Iter>
+Iter argmin(Iter begin, Iter end, std::false_type) { return std::min_element(begin, end); }
+template <typename Iter>
+Iter argmin(Iter begin, Iter end, std::true_type) {
+    if (begin == end) return end;
+    Iter at {Reduce_impl::find(begin, end, Reduce_impl::min_max(begin, end).first, std::true_type{})};
+    // a NaN minimum equals nothing, not even itself
+    return at != end ? at : std::min_element(begin, end);
+}
+template <typename Iter>
+Iter argmax(Iter begin, Iter end, std::false_type) { return std::max_element(begin, end); }
+template <typename Iter>
+Iter argmax(Iter begin, Iter end, std::true_type) {
+    if (begin == end) return end;
+    Iter at {Reduce_impl::find(begin, end, Reduce_impl::min_max(begin, end).second, std::true_type{})};
+    return at != end ? at : std::max_element(begin, end);
+}
+}	// end namespace Select_impl
+
+// first smallest and first largest elements, like std::min_element and std::max_element
+// for primitive keys the value is found with the min_max kernel, then its first position with a SIMD search
+template <typename Iter>
+Iter argmin(Iter begin, Iter end) {
+    return Select_impl::argmin(begin, end, std::integral_constant<bool, Reduce_impl::Contiguous<Iter>::value>{});
+}
+template <typename Iter>
+Iter argmax(Iter begin, Iter end) {
+    return Select_impl::argmax(begin, end, std::integral_constant<bool, Reduce_impl::Contiguous<Iter>::value>{});
+}
+
+// integers are summed as 64 bit, floating point sums are added lane by lane with SIMD
+template <typename Iter>
+Reduce_impl::Sum_type<Iter_value<Iter>> sum(Iter begin, Iter end) {
+    return Reduce_impl::sum(begin, end, std::integral_constant<bool, Reduce_impl::Contiguous<Iter>::value>{});
+}
+
+// parallel versions for ranges too large for one core's memory bandwidth; threads = 0 uses every hardware thread
+// each thread reduces an even slice, ties between slices go to the earlier one
+template <typename Iter>
+std::pair<Iter_value<Iter>, Iter_value<Iter>> par_min_max(Iter begin, Iter end, unsigned threads = 0) {
+    auto parts = Reduce_impl::on_slices(begin, end, threads, [](Iter first, Iter last) { return min_max(first, last); });
+    auto res = parts[0];
+    for (const auto& part : parts) {
+        if (part.first < res.first) res.first = part.first;
+        if (res.second < part.second) res.second = part.second;
     }
-    return {min,max};
+    return res;
+}
+template <typename Iter>
+Iter par_argmin(Iter begin, Iter end, unsigned threads = 0) {
+    auto parts = Reduce_impl::on_slices(begin, end, threads, [end](Iter first, Iter last) {
+        Iter m {argmin(first, last)};
+        return m == last ? end : m;
+    });
+    Iter res {parts[0]};
+    for (Iter m : parts) if (res == end || (m != end && *m < *res)) res = m;
+    return res;
+}
+template <typename Iter>
+Iter par_argmax(Iter begin, Iter end, unsigned threads = 0) {
+    auto parts = Reduce_impl::on_slices(begin, end, threads, [end](Iter first, Iter last) {
+        Iter m {argmax(first, last)};
+        return m == last ? end : m;
+    });
+    Iter res {parts[0]};
+    for (Iter m : parts) if (res == end || (m != end && *res < *m)) res = m;
+    return res;
+}
+template <typename Iter>
+Reduce_impl::Sum_type<Iter_value<Iter>> par_sum(Iter begin, Iter end, unsigned threads = 0) {
+    auto parts = Reduce_impl::on_slices(begin, end, threads, [](Iter first, Iter last) { return sum(first, last); });
+    Reduce_impl::Sum_type<Iter_value<Iter>> s {};
+    for (const auto& part : parts) s += part;
+    return s;
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+#pragma once
+#include <algorithm>	// lower_bound, upper_bound, min
+#include <cstdint>		// uint32_t
+#include <limits>
+#include <type_traits>	// is_integral, make_unsigned
+#include <vector>
+#include "static_search.h"	// Static_impl::floor_log2
+
+namespace sal {
+
+// learned index over sorted integer keys: a model guesses where a key is, a short search finishes
+// piecewise linear segments (PGM style) map keys to positions, each within eps of every key it covers;
+// a radix table on the keys' high bits (radix spline style) points straight at the few segments to check
+// uniform keys need one segment, smooth distributions a handful; duplicates and gaps only widen the search
+// the index keeps a pointer to the keys, they have to outlive it and not change
+namespace Learned_impl {
+
+constexpr size_t max_radix_bits {20};
+
+template <typename T>
+struct Segment {
+    T first;		// smallest key covered
+    size_t start;	// its position
+    double slope;	// positions per key past first
+};
+
+// segments built in one pass by shrinking a cone of slopes through the segment's first point;
+// when a point falls outside what every slope so far allows (within eps), it starts the next segment
+template <typename T>
+std::vector<Segment<T>> fit(const T* keys, size_t n, size_t eps) {
+    using U = typename std::make_unsigned<T>::type;
+    std::vector<Segment<T>> segs;
+    double lo {0}, hi {0};
+    for (size_t i = 0; i < n; ++i) {
+        if (i && keys[i] == keys[i - 1]) continue;	// only the first of equal keys is a point
+        if (!segs.empty()) {
+            const Segment<T>& s = segs.back();
+            const double dx = static_cast<U>(keys[i]) - static_cast<U>(s.first);
+            const double dy = static_cast<double>(i) - s.start;
+            const double s_lo {(dy - eps) / dx}, s_hi {(dy + eps) / dx};
+            if (std::max(lo, s_lo) <= std::min(hi, s_hi)) {
+                lo = std::max(lo, s_lo);
+                hi = std::min(hi, s_hi);
+                segs.back().slope = (lo + hi) / 2;
+                continue;
+            }
+        }
+        segs.push_back({keys[i], i, 0});
+        lo = 0;
+        hi = std::numeric_limits<double>::infinity();
+    }
+    return segs;
+}
+
+}	// end namespace Learned_impl
+
+template <typename T>
+class Learned_index {
+    static_assert(std::is_integral<T>::value, "learned index needs integer keys");
+    using U = typename std::make_unsigned<T>::type;
+    using Segment = Learned_impl::Segment<T>;
+
+    const T* keys;
+    size_t n;
+    size_t eps;
+    std::vector<Segment> segs;
+    std::vector<uint32_t> table;	// table[p] is the first segment whose first key has high bits >= p
+    unsigned shift {0};
+
+    size_t prefix(T key) const { return static_cast<U>(static_cast<U>(key) - static_cast<U>(keys[0])) >> shift; }
+
+    // last segment starting at or before key, key within [keys[0], keys[n-1]]
+    size_t segment(T key) const {
+        const size_t p {prefix(key)};
+        const size_t lo {table[p] ? table[p] - 1u : 0u}, hi {table[p + 1]};
+        return std::upper_bound(segs.begin() + lo, segs.begin() + hi, key,
+            [](T k, const Segment& s) { return k < s.first; }) - segs.begin() - 1;
+    }
+
+public:
+    Learned_index(const T* begin, const T* end, size_t eps = 32) : keys{begin}, n(end - begin), eps{eps} {
+        segs = Learned_impl::fit(keys, n, eps);
+        if (n == 0) return;
+        // enough high bits for 8 to 16 table entries per segment, the table costs 4 bytes per entry
+        const unsigned bits {std::min<unsigned>(Learned_impl::max_radix_bits, Static_impl::floor_log2(segs.size()) + 4)};
+        const U span {static_cast<U>(static_cast<U>(keys[n - 1]) - static_cast<U>(keys[0]))};
+        const unsigned span_bits {span ? Static_impl::floor_log2(span) + 1 : 0};
+        shift = span_bits > bits ? span_bits - bits : 0;
+        table.assign((span >> shift) + 2, static_cast<uint32_t>(segs.size()));
+        for (size_t s = segs.size(); s-- > 0;) table[prefix(segs[s].first)] = s;
+        for (size_t p = table.size() - 1; p-- > 0;) table[p] = std::min(table[p], table[p + 1]);
+    }
+    explicit Learned_index(const std::vector<T>& sorted, size_t eps = 32) :
+        Learned_index(sorted.data(), sorted.data() + sorted.size(), eps) {}
+
+    // rank of the first key not less than key, like std::lower_bound
+    size_t lower_bound(T key) const {
+        if (n == 0 || key <= keys[0]) return 0;
+        if (keys[n - 1] < key) return n;
+        const Segment& s = segs[segment(key)];
+        const double guess {s.start + s.slope * static_cast<U>(static_cast<U>(key) - static_cast<U>(s.first))};
+        const size_t pos {static_cast<size_t>(std::min(guess, static_cast<double>(n - 1)))};
+        // the answer is within eps of the guess unless the key falls in a gap between segments or a run of duplicates
+        const size_t lo {pos > eps ? pos - eps : 0}, hi {std::min(n, pos + eps + 2)};
+        const size_t res = std::lower_bound(keys + lo, keys + hi, key) - keys;
+        // otherwise gallop outward from the window, the cost grows with how far off the guess was
+        if (res == lo && lo > 0 && !(keys[lo - 1] < key)) {
+            size_t r {lo - 1}, step {1};
+            while (r >= step && !(keys[r - step] < key)) { r -= step; step *= 2; }
+            return std::lower_bound(keys + (r >= step ? r - step : 0), keys + r, key) - keys;
+        }
+        if (res == hi && hi < n) {
+            size_t l {hi}, step {1};
+            while (l + step < n && keys[l + step] < key) { l += step; step *= 2; }
+            return std::lower_bound(keys + l, keys + std::min(n, l + step + 1), key) - keys;
+        }
+        return res;
+    }
+    // rank of the first key greater than key
+    size_t upper_bound(T key) const {
+        const size_t lb {lower_bound(key)};
+        if (lb == n || keys[lb] != key) return lb;
+        // galloping past the equal keys, usually just one
+        size_t step {1}, lo {lb};
+        while (lo + step < n && keys[lo + step] == key) { lo += step; step *= 2; }
+        return std::upper_bound(keys + lo, keys + std::min(n, lo + step), key) - keys;
+    }
+    // rank of a key equal to key, n if there's none
+    size_t find(T key) const {
+        const size_t lb {lower_bound(key)};
+        return lb < n && keys[lb] == key ? lb : n;
+    }
+    bool contains(T key) const { return find(key) != n; }
+
+    size_t size() const { return n; }
+    size_t segments() const { return segs.size(); }
+    // memory on top of the keys
+    size_t bytes() const { return segs.size() * sizeof(Segment) + table.size() * sizeof(uint32_t); }
+};
+
+}
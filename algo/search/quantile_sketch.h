@@ -0,0 +1,169 @@
+#pragma once
+#include <algorithm>	// max, upper_bound
+#include <cstdint>		// uint64_t
+#include <functional>	// less
+#include <utility>		// pair, move
+#include <vector>
+#include "../sort/pdq_sort.h"
+#include "../../data/heap.h"
+
+namespace sal {
+
+// one pass, bounded memory order statistics over streams too large to keep, ex. live latency percentiles
+// both are mergeable, so each thread or shard keeps its own and they're combined before querying
+
+namespace Sketch_impl {
+constexpr size_t min_capacity {8};	// smallest compactor, keeps the low levels from thrashing
+}
+
+// KLL quantile sketch (Karnin, Lang and Liberty), works for any T under a strict weak order
+// a stack of compactors: level h holds items standing for 2^h stream items each; a full level is
+// sorted and every other item (from a random offset) is promoted, halving its weight in items
+// capacities shrink by 2/3 going down from the top level, so ~3k items are kept however long the stream
+// a quantile is off by about 1.7/k of the stream's size in rank (k = 200 is within 1%)
+template <typename T, typename Cmp = std::less<T>>
+class Kll_sketch {
+    std::vector<std::vector<T>> levels;
+    uint64_t n {0};
+    size_t k;
+    size_t kept {0}, max_kept {0};	// items held and the sum of level capacities
+    Cmp cmp;
+    uint64_t rng;		// xorshift state for compaction offsets
+    T lo {}, hi {};		// exact extremes
+    // weighted items sorted, rebuilt lazily after updates
+    mutable std::vector<std::pair<T, uint64_t>> view;
+    mutable bool view_ok {false};
+
+    size_t capacity(size_t level) const {
+        double cap {static_cast<double>(k)};
+        for (size_t h = level + 1; h < levels.size(); ++h) cap *= 2.0 / 3;
+        return std::max(Sketch_impl::min_capacity, static_cast<size_t>(cap + 0.5));
+    }
+    void add_level() {
+        levels.emplace_back();
+        max_kept = 0;
+        for (size_t h = 0; h < levels.size(); ++h) max_kept += capacity(h);
+    }
+    bool coin() {
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        return rng & 1;
+    }
+
+    // promotes half of the lowest full level; an odd item out stays behind
+    void compress() {
+        while (kept > max_kept) {
+            size_t h {0};
+            while (levels[h].size() < capacity(h)) ++h;
+            if (h + 1 == levels.size()) add_level();
+            std::vector<T>& level = levels[h];
+            pdq_sort(level.begin(), level.end(), cmp);
+            const size_t odd {level.size() % 2};
+            for (size_t i = odd + coin(); i < level.size(); i += 2) levels[h + 1].push_back(std::move(level[i]));
+            kept -= (level.size() - odd) / 2;
+            level.resize(odd);
+        }
+        view_ok = false;
+    }
+
+    void build_view() const {
+        view.clear();
+        view.reserve(kept);
+        for (size_t h = 0; h < levels.size(); ++h)
+            for (const T& v : levels[h]) view.emplace_back(v, uint64_t{1} << h);
+        pdq_sort(view.begin(), view.end(),
+            [this](const std::pair<T, uint64_t>& a, const std::pair<T, uint64_t>& b) { return cmp(a.first, b.first); });
+        // cumulative weights so queries are binary searches
+        for (size_t i = 1; i < view.size(); ++i) view[i].second += view[i - 1].second;
+        view_ok = true;
+    }
+
+public:
+    explicit Kll_sketch(size_t k = 200, Cmp c = Cmp{}, uint64_t seed = 0x9e3779b97f4a7c15) :
+        k{std::max(k, Sketch_impl::min_capacity)}, cmp(c), rng{seed | 1} { add_level(); }
+
+    void insert(const T& v) {
+        if (n == 0 || cmp(v, lo)) lo = v;
+        if (n == 0 || cmp(hi, v)) hi = v;
+        ++n;
+        levels[0].push_back(v);
+        ++kept;
+        view_ok = false;
+        if (kept > max_kept) compress();
+    }
+
+    // combined sketch answers for both streams, other may have a different k (this one's is kept)
+    void merge(const Kll_sketch& other) {
+        if (other.n == 0) return;
+        if (n == 0 || cmp(other.lo, lo)) lo = other.lo;
+        if (n == 0 || cmp(hi, other.hi)) hi = other.hi;
+        n += other.n;
+        while (levels.size() < other.levels.size()) add_level();
+        for (size_t h = 0; h < other.levels.size(); ++h)
+            levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+        kept += other.kept;
+        compress();
+    }
+
+    // stream item at fraction q (0 to 1) of the sorted stream, T{} if empty
+    T quantile(double q) const {
+        if (n == 0) return T{};
+        if (q <= 0) return lo;
+        if (q >= 1) return hi;
+        if (!view_ok) build_view();
+        const uint64_t target {static_cast<uint64_t>(q * n)};
+        auto it = std::upper_bound(view.begin(), view.end(), target,
+            [](uint64_t t, const std::pair<T, uint64_t>& item) { return t < item.second; });
+        return it == view.end() ? hi : it->first;
+    }
+    std::vector<T> quantiles(const std::vector<double>& qs) const {
+        std::vector<T> res;
+        res.reserve(qs.size());
+        for (double q : qs) res.push_back(quantile(q));
+        return res;
+    }
+    // estimated fraction of the stream not greater than v
+    double rank(const T& v) const {
+        if (n == 0) return 0;
+        if (!view_ok) build_view();
+        auto it = std::upper_bound(view.begin(), view.end(), v,
+            [this](const T& x, const std::pair<T, uint64_t>& item) { return cmp(x, item.first); });
+        return it == view.begin() ? 0 : static_cast<double>((it - 1)->second) / n;
+    }
+
+    uint64_t size() const { return n; }
+    bool empty() const { return n == 0; }
+    size_t items() const { return kept; }
+    const T& min() const { return lo; }
+    const T& max() const { return hi; }
+};
+
+
+// the k greatest items of a stream under cmp (the k least with std::greater), O(lgk) per item
+// a min heap of what's kept so far, whose top is the bar a new item has to clear
+template <typename T, typename Cmp = std::less<T>>
+class Top_k {
+    Heap<T, Cmp> heap;
+    size_t k;
+    Cmp cmp;
+public:
+    explicit Top_k(size_t k, Cmp c = Cmp{}) : heap{Cmp(c)}, k{k}, cmp(c) {}
+
+    void push(const T& v) {
+        if (heap.size() < k) heap.insert(v);
+        else if (k && cmp(heap.top(), v)) heap.replace_top(T(v));
+    }
+    void merge(const Top_k& other) { for (const T& v : other.heap) push(v); }
+
+    // kept items, greatest first
+    std::vector<T> sorted() const {
+        std::vector<T> res(heap.begin(), heap.end());
+        pdq_sort(res.begin(), res.end(), [this](const T& a, const T& b) { return cmp(b, a); });
+        return res;
+    }
+    // least item kept, a new item has to beat it once k are kept
+    const T& threshold() const { return heap.top(); }
+    size_t size() const { return heap.size(); }
+    bool empty() const { return heap.empty(); }
+};
+
+}
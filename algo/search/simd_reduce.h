@@ -0,0 +1,490 @@
+#pragma once
+#include <algorithm>	// min, max
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>	// conditional, is_integral, is_signed
+#include <utility>		// pair
+#include <vector>
+#include "../macros.h"	// Iter_value
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SAL_REDUCE_AVX2
+#define SAL_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace sal {
+namespace Reduce_impl {
+
+// min, max, search and sum kernels over contiguous primitive keys, instruction set picked at run time:
+// AVX2 when the CPU has it (checked once), else SSE2 (always there on x86-64), else scalar
+// kernels are written once against Ops<T, Isa>; the AVX2 entry points are compiled for AVX2 with
+// everything flattened into them, so the rest of the program needs no -mavx2
+// NaNs give unspecified results and floating point sums are added lane by lane, not left to right
+struct Sse2 {};
+struct Avx2 {};
+
+template <typename T, typename Isa>
+struct Ops { static constexpr bool available = false; };
+
+// sums of integers are 64 bit
+template <typename T>
+using Sum_type = typename std::conditional<std::is_integral<T>::value,
+    typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type, T>::type;
+
+inline unsigned ctz(unsigned m) {
+#if defined(__GNUC__)
+    return __builtin_ctz(m);
+#else
+    unsigned n {0};
+    while (!(m & 1)) { m >>= 1; ++n; }
+    return n;
+#endif
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"	// vectors passed between the inlined AVX2 helpers
+#endif
+
+#if defined(__SSE2__)
+template <>
+struct Ops<int32_t, Sse2> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 4;
+    using Vec = __m128i;
+    using Acc = __m128i;	// 2 64 bit sums
+    static Vec load(const int32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static Vec set1(int32_t x) { return _mm_set1_epi32(x); }
+    static void store(int32_t* p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    // no 32 bit min before SSE4.1, select through the compare mask
+    static Vec min(Vec a, Vec b) { Vec gt {_mm_cmpgt_epi32(a, b)}; return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a)); }
+    static Vec max(Vec a, Vec b) { Vec gt {_mm_cmpgt_epi32(a, b)}; return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b)); }
+    static unsigned eq(Vec a, Vec b) { return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))); }
+    static Acc zero() { return _mm_setzero_si128(); }
+    static Acc add(Acc acc, Vec v) {
+        Vec sign {_mm_cmpgt_epi32(_mm_setzero_si128(), v)};
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, sign));
+        return _mm_add_epi64(acc, _mm_unpackhi_epi32(v, sign));
+    }
+    static Acc combine(Acc a, Acc b) { return _mm_add_epi64(a, b); }
+    static long long total(Acc acc) {
+        alignas(16) long long s[2];
+        _mm_store_si128(reinterpret_cast<__m128i*>(s), acc);
+        return s[0] + s[1];
+    }
+};
+template <>
+struct Ops<uint32_t, Sse2> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 4;
+    using Vec = __m128i;
+    using Acc = __m128i;
+    static Vec load(const uint32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static Vec set1(uint32_t x) { return _mm_set1_epi32(static_cast<int32_t>(x)); }
+    static void store(uint32_t* p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    // unsigned order is signed order with the sign bits flipped
+    static Vec gt(Vec a, Vec b) {
+        const Vec bias {_mm_set1_epi32(INT32_MIN)};
+        return _mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+    }
+    static Vec min(Vec a, Vec b) { Vec m {gt(a, b)}; return _mm_or_si128(_mm_and_si128(m, b), _mm_andnot_si128(m, a)); }
+    static Vec max(Vec a, Vec b) { Vec m {gt(a, b)}; return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+    static unsigned eq(Vec a, Vec b) { return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))); }
+    static Acc zero() { return _mm_setzero_si128(); }
+    static Acc add(Acc acc, Vec v) {
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, _mm_setzero_si128()));
+        return _mm_add_epi64(acc, _mm_unpackhi_epi32(v, _mm_setzero_si128()));
+    }
+    static Acc combine(Acc a, Acc b) { return _mm_add_epi64(a, b); }
+    static unsigned long long total(Acc acc) {
+        alignas(16) unsigned long long s[2];
+        _mm_store_si128(reinterpret_cast<__m128i*>(s), acc);
+        return s[0] + s[1];
+    }
+};
+template <>
+struct Ops<float, Sse2> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 4;
+    using Vec = __m128;
+    using Acc = __m128;
+    static Vec load(const float* p) { return _mm_loadu_ps(p); }
+    static Vec set1(float x) { return _mm_set1_ps(x); }
+    static void store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+    static Vec min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+    static unsigned eq(Vec a, Vec b) { return _mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+    static Acc zero() { return _mm_setzero_ps(); }
+    static Acc add(Acc acc, Vec v) { return _mm_add_ps(acc, v); }
+    static Acc combine(Acc a, Acc b) { return _mm_add_ps(a, b); }
+    static float total(Acc acc) {
+        alignas(16) float s[4];
+        _mm_store_ps(s, acc);
+        return (s[0] + s[1]) + (s[2] + s[3]);
+    }
+};
+template <>
+struct Ops<double, Sse2> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 2;
+    using Vec = __m128d;
+    using Acc = __m128d;
+    static Vec load(const double* p) { return _mm_loadu_pd(p); }
+    static Vec set1(double x) { return _mm_set1_pd(x); }
+    static void store(double* p, Vec v) { _mm_storeu_pd(p, v); }
+    static Vec min(Vec a, Vec b) { return _mm_min_pd(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm_max_pd(a, b); }
+    static unsigned eq(Vec a, Vec b) { return _mm_movemask_pd(_mm_cmpeq_pd(a, b)); }
+    static Acc zero() { return _mm_setzero_pd(); }
+    static Acc add(Acc acc, Vec v) { return _mm_add_pd(acc, v); }
+    static Acc combine(Acc a, Acc b) { return _mm_add_pd(a, b); }
+    static double total(Acc acc) {
+        alignas(16) double s[2];
+        _mm_store_pd(s, acc);
+        return s[0] + s[1];
+    }
+};
+#endif
+
+#if defined(SAL_REDUCE_AVX2)
+template <>
+struct Ops<int32_t, Avx2> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 8;
+    using Vec = __m256i;
+    using Acc = __m256i;	// 4 64 bit sums
+    SAL_AVX2_TARGET static Vec load(const int32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    SAL_AVX2_TARGET static Vec set1(int32_t x) { return _mm256_set1_epi32(x); }
+    SAL_AVX2_TARGET static void store(int32_t* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    SAL_AVX2_TARGET static Vec min(Vec a, Vec b) { return _mm256_min_epi32(a, b); }
+    SAL_AVX2_TARGET static Vec max(Vec a, Vec b) { return _mm256_max_epi32(a, b); }
+    SAL_AVX2_TARGET static unsigned eq(Vec a, Vec b) { return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))); }
+    SAL_AVX2_TARGET static Acc zero() { return _mm256_setzero_si256(); }
+    SAL_AVX2_TARGET static Acc add(Acc acc, Vec v) {
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        return _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    SAL_AVX2_TARGET static Acc combine(Acc a, Acc b) { return _mm256_add_epi64(a, b); }
+    SAL_AVX2_TARGET static long long total(Acc acc) {
+        alignas(32) long long s[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(s), acc);
+        return (s[0] + s[1]) + (s[2] + s[3]);
+    }
+};
+template <>
+struct Ops<uint32_t, Avx2> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 8;
+    using Vec = __m256i;
+    using Acc = __m256i;
+    SAL_AVX2_TARGET static Vec load(const uint32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    SAL_AVX2_TARGET static Vec set1(uint32_t x) { return _mm256_set1_epi32(static_cast<int32_t>(x)); }
+    SAL_AVX2_TARGET static void store(uint32_t* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    SAL_AVX2_TARGET static Vec min(Vec a, Vec b) { return _mm256_min_epu32(a, b); }
+    SAL_AVX2_TARGET static Vec max(Vec a, Vec b) { return _mm256_max_epu32(a, b); }
+    SAL_AVX2_TARGET static unsigned eq(Vec a, Vec b) { return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))); }
+    SAL_AVX2_TARGET static Acc zero() { return _mm256_setzero_si256(); }
+    SAL_AVX2_TARGET static Acc add(Acc acc, Vec v) {
+        acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(v)));
+        return _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    SAL_AVX2_TARGET static Acc combine(Acc a, Acc b) { return _mm256_add_epi64(a, b); }
+    SAL_AVX2_TARGET static unsigned long long total(Acc acc) {
+        alignas(32) unsigned long long s[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(s), acc);
+        return (s[0] + s[1]) + (s[2] + s[3]);
+    }
+};
+// no 64 bit min and max before AVX-512, blend on the compare
+template <>
+struct Ops<int64_t, Avx2> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 4;
+    using Vec = __m256i;
+    using Acc = __m256i;
+    SAL_AVX2_TARGET static Vec load(const int64_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    SAL_AVX2_TARGET static Vec set1(int64_t x) { return _mm256_set1_epi64x(x); }
+    SAL_AVX2_TARGET static void store(int64_t* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    SAL_AVX2_TARGET static Vec min(Vec a, Vec b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+    SAL_AVX2_TARGET static Vec max(Vec a, Vec b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+    SAL_AVX2_TARGET static unsigned eq(Vec a, Vec b) { return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b))); }
+    SAL_AVX2_TARGET static Acc zero() { return _mm256_setzero_si256(); }
+    SAL_AVX2_TARGET static Acc add(Acc acc, Vec v) { return _mm256_add_epi64(acc, v); }
+    SAL_AVX2_TARGET static Acc combine(Acc a, Acc b) { return _mm256_add_epi64(a, b); }
+    SAL_AVX2_TARGET static long long total(Acc acc) {
+        alignas(32) long long s[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(s), acc);
+        return (s[0] + s[1]) + (s[2] + s[3]);
+    }
+};
+template <>
+struct Ops<float, Avx2> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 8;
+    using Vec = __m256;
+    using Acc = __m256;
+    SAL_AVX2_TARGET static Vec load(const float* p) { return _mm256_loadu_ps(p); }
+    SAL_AVX2_TARGET static Vec set1(float x) { return _mm256_set1_ps(x); }
+    SAL_AVX2_TARGET static void store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+    SAL_AVX2_TARGET static Vec min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+    SAL_AVX2_TARGET static Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+    SAL_AVX2_TARGET static unsigned eq(Vec a, Vec b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+    SAL_AVX2_TARGET static Acc zero() { return _mm256_setzero_ps(); }
+    SAL_AVX2_TARGET static Acc add(Acc acc, Vec v) { return _mm256_add_ps(acc, v); }
+    SAL_AVX2_TARGET static Acc combine(Acc a, Acc b) { return _mm256_add_ps(a, b); }
+    SAL_AVX2_TARGET static float total(Acc acc) {
+        alignas(32) float s[8];
+        _mm256_store_ps(s, acc);
+        return ((s[0] + s[1]) + (s[2] + s[3])) + ((s[4] + s[5]) + (s[6] + s[7]));
+    }
+};
+template <>
+struct Ops<double, Avx2> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 4;
+    using Vec = __m256d;
+    using Acc = __m256d;
+    SAL_AVX2_TARGET static Vec load(const double* p) { return _mm256_loadu_pd(p); }
+    SAL_AVX2_TARGET static Vec set1(double x) { return _mm256_set1_pd(x); }
+    SAL_AVX2_TARGET static void store(double* p, Vec v) { _mm256_storeu_pd(p, v); }
+    SAL_AVX2_TARGET static Vec min(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+    SAL_AVX2_TARGET static Vec max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+    SAL_AVX2_TARGET static unsigned eq(Vec a, Vec b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+    SAL_AVX2_TARGET static Acc zero() { return _mm256_setzero_pd(); }
+    SAL_AVX2_TARGET static Acc add(Acc acc, Vec v) { return _mm256_add_pd(acc, v); }
+    SAL_AVX2_TARGET static Acc combine(Acc a, Acc b) { return _mm256_add_pd(a, b); }
+    SAL_AVX2_TARGET static double total(Acc acc) {
+        alignas(32) double s[4];
+        _mm256_store_pd(s, acc);
+        return (s[0] + s[1]) + (s[2] + s[3]);
+    }
+};
+#endif
+
+// kernels, n is at least 2 registers wide
+// two accumulators per result so consecutive loads don't wait on each other
+template <typename T, typename O>
+void min_max_kernel(const T* p, size_t n, T& lo, T& hi) {
+    using Vec = typename O::Vec;
+    constexpr size_t w {O::lanes};
+    Vec lo0 {O::load(p)}, hi0 {lo0}, lo1 {O::load(p + w)}, hi1 {lo1};
+    size_t i {2 * w};
+    for (; i + 2 * w <= n; i += 2 * w) {
+        Vec a {O::load(p + i)}, b {O::load(p + i + w)};
+        lo0 = O::min(lo0, a); hi0 = O::max(hi0, a);
+        lo1 = O::min(lo1, b); hi1 = O::max(hi1, b);
+    }
+    if (i + w <= n) {
+        Vec a {O::load(p + i)};
+        lo0 = O::min(lo0, a); hi0 = O::max(hi0, a);
+    }
+    // the last register overlaps what's been seen, harmless for min and max
+    Vec last {O::load(p + n - w)};
+    lo0 = O::min(O::min(lo0, lo1), last);
+    hi0 = O::max(O::max(hi0, hi1), last);
+    T los[w], his[w];
+    O::store(los, lo0);
+    O::store(his, hi0);
+    lo = los[0]; hi = his[0];
+    for (size_t l = 1; l < w; ++l) {
+        if (los[l] < lo) lo = los[l];
+        if (hi < his[l]) hi = his[l];
+    }
+}
+
+// index of the first element equal to x, n if none
+template <typename T, typename O>
+size_t find_kernel(const T* p, size_t n, T x) {
+    constexpr size_t w {O::lanes};
+    const typename O::Vec key {O::set1(x)};
+    size_t i {0};
+    for (; i + 2 * w <= n; i += 2 * w) {
+        unsigned a {O::eq(O::load(p + i), key)}, b {O::eq(O::load(p + i + w), key)};
+        if (a | b) return a ? i + ctz(a) : i + w + ctz(b);
+    }
+    for (; i < n; ++i) if (p[i] == x) return i;
+    return n;
+}
+
+template <typename T, typename O>
+Sum_type<T> sum_kernel(const T* p, size_t n) {
+    constexpr size_t w {O::lanes};
+    typename O::Acc a0 {O::zero()}, a1 {O::zero()};
+    size_t i {0};
+    for (; i + 2 * w <= n; i += 2 * w) {
+        a0 = O::add(a0, O::load(p + i));
+        a1 = O::add(a1, O::load(p + i + w));
+    }
+    Sum_type<T> s {O::total(O::combine(a0, a1))};
+    for (; i < n; ++i) s += p[i];
+    return s;
+}
+
+// entry points per instruction set; the primary template is the missing one
+template <typename T, typename Isa, bool = Ops<T, Isa>::available>
+struct Kernels {
+    static constexpr bool available = false;
+    static void min_max(const T*, size_t, T&, T&) {}
+    static size_t find(const T*, size_t n, T) { return n; }
+    static Sum_type<T> sum(const T*, size_t) { return 0; }
+};
+template <typename T>
+struct Kernels<T, Sse2, true> {
+    static constexpr bool available = true;
+    static void min_max(const T* p, size_t n, T& lo, T& hi) { min_max_kernel<T, Ops<T, Sse2>>(p, n, lo, hi); }
+    static size_t find(const T* p, size_t n, T x) { return find_kernel<T, Ops<T, Sse2>>(p, n, x); }
+    static Sum_type<T> sum(const T* p, size_t n) { return sum_kernel<T, Ops<T, Sse2>>(p, n); }
+};
+#if defined(SAL_REDUCE_AVX2)
+template <typename T>
+struct Kernels<T, Avx2, true> {
+    static constexpr bool available = true;
+    __attribute__((target("avx2"), flatten))
+    static void min_max(const T* p, size_t n, T& lo, T& hi) { min_max_kernel<T, Ops<T, Avx2>>(p, n, lo, hi); }
+    __attribute__((target("avx2"), flatten))
+    static size_t find(const T* p, size_t n, T x) { return find_kernel<T, Ops<T, Avx2>>(p, n, x); }
+    __attribute__((target("avx2"), flatten))
+    static Sum_type<T> sum(const T* p, size_t n) { return sum_kernel<T, Ops<T, Avx2>>(p, n); }
+};
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+inline bool has_avx2() {
+#if defined(__AVX2__)
+    return true;
+#elif defined(SAL_REDUCE_AVX2)
+    static const bool avx2 {__builtin_cpu_supports("avx2") != 0};
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+// which instruction set a kernel call on n T takes, scalar if none fits
+enum class Isa_choice {scalar, sse2, avx2};
+template <typename T>
+Isa_choice choose(size_t n) {
+    if (Kernels<T, Avx2>::available && n >= 2 * 8 && has_avx2()) return Isa_choice::avx2;
+    if (Kernels<T, Sse2>::available && n >= 2 * 4) return Isa_choice::sse2;
+    return Isa_choice::scalar;
+}
+
+// contiguous primitive keys go to the kernels, everything else stays scalar
+template <typename Iter>
+struct Contiguous {
+    using T = Iter_value<Iter>;
+    static constexpr bool value = std::is_arithmetic<T>::value &&
+        (std::is_same<Iter, T*>::value || std::is_same<Iter, const T*>::value ||
+         std::is_same<Iter, typename std::vector<T>::iterator>::value ||
+         std::is_same<Iter, typename std::vector<T>::const_iterator>::value);
+};
+
+// pairs compared to each other first, then the smaller against min and larger against max, 3n/2 comparisons
+// forward iterators are enough; an odd element out at the end is compared on its own
+template <typename Iter>
+std::pair<Iter_value<Iter>, Iter_value<Iter>> min_max(Iter begin, Iter end, std::false_type) {
+    using T = Iter_value<Iter>;
+    if (begin == end) return {T{}, T{}};
+    T lo {*begin}, hi {*begin};
+    for (++begin; begin != end; ++begin) {
+        Iter next {begin};
+        if (++next == end) {
+            if (*begin < lo) lo = *begin;
+            else if (hi < *begin) hi = *begin;
+            break;
+        }
+        if (*begin < *next) {
+            if (*begin < lo) lo = *begin;
+            if (hi < *next) hi = *next;
+        }
+        else {
+            if (hi < *begin) hi = *begin;
+            if (*next < lo) lo = *next;
+        }
+        begin = next;
+    }
+    return {lo, hi};
+}
+template <typename Iter>
+std::pair<Iter_value<Iter>, Iter_value<Iter>> min_max(Iter begin, Iter end, std::true_type) {
+    using T = Iter_value<Iter>;
+    const size_t n = end - begin;
+    const T* p {n ? &*begin : nullptr};
+    T lo, hi;
+    switch (choose<T>(n)) {
+        case Isa_choice::avx2: Kernels<T, Avx2>::min_max(p, n, lo, hi); return {lo, hi};
+        case Isa_choice::sse2: Kernels<T, Sse2>::min_max(p, n, lo, hi); return {lo, hi};
+        default: return min_max(p, p + n, std::false_type{});
+    }
+}
+template <typename Iter>
+std::pair<Iter_value<Iter>, Iter_value<Iter>> min_max(Iter begin, Iter end) {
+    return min_max(begin, end, std::integral_constant<bool, Contiguous<Iter>::value>{});
+}
+
+// first element equal to x
+template <typename Iter>
+Iter find(Iter begin, Iter end, const Iter_value<Iter>& x, std::false_type) {
+    while (begin != end && !(*begin == x)) ++begin;
+    return begin;
+}
+template <typename Iter>
+Iter find(Iter begin, Iter end, const Iter_value<Iter>& x, std::true_type) {
+    using T = Iter_value<Iter>;
+    const size_t n = end - begin;
+    const T* p {n ? &*begin : nullptr};
+    switch (choose<T>(n)) {
+        case Isa_choice::avx2: return begin + Kernels<T, Avx2>::find(p, n, x);
+        case Isa_choice::sse2: return begin + Kernels<T, Sse2>::find(p, n, x);
+        default: return find(begin, end, x, std::false_type{});
+    }
+}
+
+template <typename Iter>
+Sum_type<Iter_value<Iter>> sum(Iter begin, Iter end, std::false_type) {
+    Sum_type<Iter_value<Iter>> s {};
+    for (; begin != end; ++begin) s += *begin;
+    return s;
+}
+template <typename Iter>
+Sum_type<Iter_value<Iter>> sum(Iter begin, Iter end, std::true_type) {
+    using T = Iter_value<Iter>;
+    const size_t n = end - begin;
+    const T* p {n ? &*begin : nullptr};
+    switch (choose<T>(n)) {
+        case Isa_choice::avx2: return Kernels<T, Avx2>::sum(p, n);
+        case Isa_choice::sse2: return Kernels<T, Sse2>::sum(p, n);
+        default: return sum(begin, end, std::false_type{});
+    }
+}
+
+// threads split the range into even slices, each reduces its own and the results are combined in order
+constexpr size_t parallel_cutoff {1 << 18};		// # elements per thread before threads pay off
+
+inline unsigned pick_threads(unsigned threads, size_t n) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, n / parallel_cutoff)));
+}
+
+// f(first, last) of every slice, in slice order
+template <typename Iter, typename F>
+auto on_slices(Iter begin, Iter end, unsigned threads, F f) -> std::vector<decltype(f(begin, end))> {
+    const size_t n = end - begin;
+    threads = pick_threads(threads, n);
+    std::vector<decltype(f(begin, end))> res(threads);
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t)
+        workers.emplace_back([&, t]() { res[t] = f(begin + n * t / threads, begin + n * (t + 1) / threads); });
+    res[0] = f(begin, begin + n / threads);
+    for (auto& w : workers) w.join();
+    return res;
+}
+
+}	// end namespace Reduce_impl
+}
@@ -0,0 +1,229 @@
+#pragma once
+#include <algorithm>	// lower_bound, sort, copy
+#include <cstdint>		// uint64_t
+#include <iterator>		// back_inserter, distance, prev
+#include <type_traits>	// integral_constant, is_integral, make_unsigned
+#include <vector>
+#include "../macros.h"		// Iter_value
+#include "simd_reduce.h"	// Reduce_impl::Contiguous, ctz
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace sal {
+
+// set operations on sorted sequences without repeats, ex. posting lists of an inverted index
+// unlike intersection() these need no hashing or allocation, and take time by how the sizes compare:
+// similar sizes are merged (4 by 4 with SSE2 for 32 bit integers), a much shorter one gallops through the longer
+// results are written through out in order, out past the last one is returned like std::set_intersection
+namespace Set_impl {
+
+constexpr size_t gallop_ratio {32};		// longer over shorter past this, search instead of merge
+constexpr size_t bitmap_density {8};	// ids per bitmap word (64 bits) at least this many for the bitmap path
+
+// first position in [begin, end) not less than key, searching ahead in doubling steps
+template <typename Iter, typename T>
+Iter gallop(Iter begin, Iter end, const T& key) {
+    size_t step {1};
+    Iter lo {begin};
+    while (end - lo > static_cast<Iter_diff<Iter>>(step) && *(lo + step) < key) {
+        lo += step;
+        step *= 2;
+    }
+    Iter hi {end - lo > static_cast<Iter_diff<Iter>>(step) ? lo + step + 1 : end};
+    return std::lower_bound(lo, hi, key);
+}
+
+// each element of the short side is searched for from where the last one was found
+template <typename Iter1, typename Iter2, typename Out>
+Out intersect_gallop(Iter1 small, Iter1 small_end, Iter2 large, Iter2 large_end, Out out) {
+    for (; small != small_end && large != large_end; ++small) {
+        large = gallop(large, large_end, *small);
+        if (large != large_end && !(*small < *large)) { *out++ = *small; ++large; }
+    }
+    return out;
+}
+
+template <typename Iter1, typename Iter2, typename Out>
+Out intersect_merge(Iter1 a, Iter1 a_end, Iter2 b, Iter2 b_end, Out out) {
+    while (a != a_end && b != b_end) {
+        if (*a < *b) ++a;
+        else if (*b < *a) ++b;
+        else { *out++ = *a; ++a; ++b; }
+    }
+    return out;
+}
+
+template <typename Iter>
+struct Simd_ok {
+    using T = Iter_value<Iter>;
+    static constexpr bool value = Reduce_impl::Contiguous<Iter>::value && std::is_integral<T>::value && sizeof(T) == 4;
+};
+
+#if defined(__SSE2__)
+// 4 of a against 4 of b and their 3 rotations: a mask of which of a's are in b's block;
+// then the block with the smaller last element advances (both if equal)
+// equality doesn't care about signedness, so this serves signed and unsigned 32 bit keys
+template <typename Iter1, typename Iter2, typename Out>
+Out intersect_merge(Iter1 a_begin, Iter1 a_end, Iter2 b_begin, Iter2 b_end, Out out, std::true_type) {
+    using T = Iter_value<Iter1>;
+    const size_t na = a_end - a_begin, nb = b_end - b_begin;
+    if (na == 0 || nb == 0) return out;
+    const T* a {&*a_begin};
+    const T* b {&*b_begin};
+    size_t i {0}, j {0};
+    while (i + 4 <= na && j + 4 <= nb) {
+        const __m128i va {_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i))};
+        const __m128i vb {_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j))};
+        __m128i eq {_mm_cmpeq_epi32(va, vb)};
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        for (unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(eq)); mask; mask &= mask - 1)
+            *out++ = a[i + Reduce_impl::ctz(mask)];
+        const T a_last {a[i + 3]}, b_last {b[j + 3]};
+        i += a_last < b_last || a_last == b_last ? 4 : 0;
+        j += b_last < a_last || a_last == b_last ? 4 : 0;
+    }
+    return intersect_merge(a + i, a + na, b + j, b + nb, out);
+}
+#else
+template <typename Iter1, typename Iter2, typename Out>
+Out intersect_merge(Iter1 a, Iter1 a_end, Iter2 b, Iter2 b_end, Out out, std::true_type) {
+    return intersect_merge(a, a_end, b, b_end, out);
+}
+#endif
+template <typename Iter1, typename Iter2, typename Out>
+Out intersect_merge(Iter1 a, Iter1 a_end, Iter2 b, Iter2 b_end, Out out, std::false_type) {
+    return intersect_merge(a, a_end, b, b_end, out);
+}
+
+inline unsigned ctz64(uint64_t m) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(m);
+#else
+    return static_cast<uint32_t>(m) ? Reduce_impl::ctz(static_cast<uint32_t>(m)) : 32 + Reduce_impl::ctz(m >> 32);
+#endif
+}
+
+// id's offset from lo, without overflow for signed ids far apart
+template <typename T>
+uint64_t offset(T v, T lo) {
+    using U = typename std::make_unsigned<T>::type;
+    return static_cast<U>(static_cast<U>(v) - static_cast<U>(lo));
+}
+
+// dense integer ids: one bit per id in [lo, hi] for the first set, anded with each of the others
+template <typename Sequence, typename T>
+std::vector<T> intersect_bitmap(const std::vector<const Sequence*>& sets, T lo, T hi) {
+    const size_t words {static_cast<size_t>(offset(hi, lo) / 64 + 1)};
+    std::vector<uint64_t> bits(words), other(words);
+    for (const T& v : *sets[0]) bits[offset(v, lo) / 64] |= uint64_t{1} << (offset(v, lo) % 64);
+    for (size_t s = 1; s < sets.size(); ++s) {
+        std::fill(other.begin(), other.end(), 0);
+        for (auto v = std::lower_bound(sets[s]->begin(), sets[s]->end(), lo); v != sets[s]->end() && !(hi < *v); ++v)
+            other[offset(*v, lo) / 64] |= uint64_t{1} << (offset(*v, lo) % 64);
+        for (size_t w = 0; w < words; ++w) bits[w] &= other[w];
+    }
+    std::vector<T> res;
+    for (size_t w = 0; w < words; ++w)
+        for (uint64_t word = bits[w]; word; word &= word - 1)
+            res.push_back(static_cast<T>(lo + static_cast<T>(w * 64 + ctz64(word))));
+    return res;
+}
+
+// whether the ids of every set between lo and hi fill enough of a bitmap over that range to beat merging
+template <typename Sequence, typename T>
+bool dense(const std::vector<const Sequence*>& sets, T lo, T hi, std::true_type) {
+    const double words {static_cast<double>(offset(hi, lo)) / 64 + 1};
+    for (const Sequence* s : sets) {
+        const auto first = std::lower_bound(s->begin(), s->end(), lo);
+        const auto last = std::upper_bound(first, s->end(), hi);
+        if ((last - first) < words * bitmap_density) return false;
+    }
+    return true;
+}
+template <typename Sequence, typename T>
+bool dense(const std::vector<const Sequence*>&, T, T, std::false_type) { return false; }
+
+template <typename Sequence, typename T>
+std::vector<T> intersect_bitmap(const std::vector<const Sequence*>&, T, T, std::false_type) { return {}; }
+template <typename Sequence, typename T>
+std::vector<T> intersect_bitmap(const std::vector<const Sequence*>& sets, T lo, T hi, std::true_type) {
+    return intersect_bitmap(sets, lo, hi);
+}
+
+}	// end namespace Set_impl
+
+// elements in both; gallops when one side is over gallop_ratio times the other, else merges
+template <typename Iter1, typename Iter2, typename Out>
+Out intersect_sorted(Iter1 a, Iter1 a_end, Iter2 b, Iter2 b_end, Out out) {
+    using namespace Set_impl;
+    const size_t na = std::distance(a, a_end), nb = std::distance(b, b_end);
+    if (na * gallop_ratio < nb) return intersect_gallop(a, a_end, b, b_end, out);
+    if (nb * gallop_ratio < na) return intersect_gallop(b, b_end, a, a_end, out);
+    using Simd = std::integral_constant<bool, Simd_ok<Iter1>::value && Simd_ok<Iter2>::value &&
+        std::is_same<Iter_value<Iter1>, Iter_value<Iter2>>::value>;
+    return intersect_merge(a, a_end, b, b_end, out, Simd{});
+}
+
+// elements in either
+template <typename Iter1, typename Iter2, typename Out>
+Out union_sorted(Iter1 a, Iter1 a_end, Iter2 b, Iter2 b_end, Out out) {
+    while (a != a_end && b != b_end) {
+        if (*a < *b) *out++ = *a++;
+        else if (*b < *a) *out++ = *b++;
+        else { *out++ = *a++; ++b; }
+    }
+    out = std::copy(a, a_end, out);
+    return std::copy(b, b_end, out);
+}
+
+// elements of a not in b; when a is much shorter each one is searched for in b
+template <typename Iter1, typename Iter2, typename Out>
+Out difference_sorted(Iter1 a, Iter1 a_end, Iter2 b, Iter2 b_end, Out out) {
+    const size_t na = std::distance(a, a_end), nb = std::distance(b, b_end);
+    if (na * Set_impl::gallop_ratio < nb) {
+        for (; a != a_end; ++a) {
+            b = Set_impl::gallop(b, b_end, *a);
+            if (b == b_end || *a < *b) *out++ = *a;
+        }
+        return out;
+    }
+    while (a != a_end && b != b_end) {
+        if (*a < *b) *out++ = *a++;
+        else if (*b < *a) ++b;
+        else { ++a; ++b; }
+    }
+    return std::copy(a, a_end, out);
+}
+
+// elements in every sequence of a set of sorted sequences
+// smallest first: the running result only shrinks, so every later step is a gallop of a short list through
+// a long one, and an empty result stops early; integer ids dense enough over the smallest's range go to bitmaps
+template <typename Sequence_set>
+std::vector<typename Sequence_set::value_type::value_type> intersect_sorted(const Sequence_set& seq_set) {
+    using Sequence = typename Sequence_set::value_type;
+    using T = typename Sequence::value_type;
+    std::vector<const Sequence*> sets;
+    for (const Sequence& s : seq_set) sets.push_back(&s);
+    if (sets.empty()) return {};
+    std::sort(sets.begin(), sets.end(), [](const Sequence* a, const Sequence* b) { return a->size() < b->size(); });
+    if (sets[0]->size() == 0) return {};
+    if (sets.size() == 1) return std::vector<T>(sets[0]->begin(), sets[0]->end());
+
+    using Integral = std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value>;
+    const T lo {*sets[0]->begin()}, hi {*std::prev(sets[0]->end())};
+    if (Set_impl::dense(sets, lo, hi, Integral{})) return Set_impl::intersect_bitmap(sets, lo, hi, Integral{});
+
+    std::vector<T> res, next;
+    intersect_sorted(sets[0]->begin(), sets[0]->end(), sets[1]->begin(), sets[1]->end(), std::back_inserter(res));
+    for (size_t s = 2; s < sets.size() && !res.empty(); ++s) {
+        next.clear();
+        intersect_sorted(res.begin(), res.end(), sets[s]->begin(), sets[s]->end(), std::back_inserter(next));
+        res.swap(next);
+    }
+    return res;
+}
+
+}
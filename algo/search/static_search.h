@@ -0,0 +1,115 @@
+#pragma once
+#include <cstdint>		// uintptr_t
+#include <functional>	// less
+#include <iterator>		// distance
+#include <utility>		// pair
+#include <vector>
+#include "../macros.h"	// SAL_PREFETCH
+
+namespace sal {
+
+// searching a sorted sequence that doesn't change, many times
+// binary search on a big sorted array misses the cache on almost every probe past the first few,
+// and each probe's address depends on the last comparison, so the misses happen one after another
+namespace Static_impl {
+
+constexpr size_t cache_line {64};
+
+// nodes per cache line, rounded down to a power of 2 so a node's descendants a few levels down share a line
+constexpr size_t per_line(size_t bytes, size_t nodes = 1) {
+    return nodes * 2 * bytes > cache_line ? nodes : per_line(bytes, nodes * 2);
+}
+
+inline unsigned floor_log2(size_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(x);
+#else
+    unsigned l {0};
+    while (x >>= 1) ++l;
+    return l;
+#endif
+}
+
+// address arithmetic outside the array is fine for a prefetch, pointer arithmetic there isn't
+inline void prefetch(const void* base, size_t bytes) {
+    SAL_PREFETCH(reinterpret_cast<const void*>(reinterpret_cast<uintptr_t>(base) + bytes));
+}
+
+}	// end namespace Static_impl
+
+// sorted keys laid out in Eytzinger (breadth first) order: the root at 1, node k's children at 2k and 2k+1
+// the first levels of every search are the same few cache lines; a descent is branchless, and the
+// node 4 levels down (16 ints, all in one line) is prefetched while the levels in between are compared
+// results are 0 based ranks in the sorted order, n if there's none, so payloads can stay in sorted arrays
+// 1.0x the memory of the keys; built in O(n) from sorted input
+template <typename T, typename Cmp = std::less<T>>
+class Eytzinger {
+    std::vector<T> a;	// a[0] unused
+    size_t n;
+    size_t full;		// nodes above the last level
+    unsigned height;	// levels
+    Cmp cmp;
+
+    static constexpr size_t ahead {Static_impl::per_line(sizeof(T))};
+
+    // in order position of node k, leaves missing from the right end of the last level shift it left
+    size_t rank(size_t k) const {
+        const unsigned d {Static_impl::floor_log2(k)};
+        const size_t p {(2 * (k - (size_t{1} << d)) + 1) << (height - 1 - d)};
+        const size_t leaves {n - full}, skipped {p / 2 > leaves ? p / 2 - leaves : 0};
+        return p - skipped - 1;
+    }
+
+    // goes right past every node the key belongs after, then backs up to the last left turn
+    // less(node) decides which: node < key for lower bound, !(key < node) for upper bound
+    template <typename Less>
+    size_t descend(Less less) const {
+        size_t k {1};
+        while (k <= n) {
+            Static_impl::prefetch(a.data(), k * ahead * sizeof(T));
+            k = 2 * k + less(a[k]);
+        }
+        // strip the trailing right turns and the left turn before them
+#if defined(__GNUC__) || defined(__clang__)
+        return k >> __builtin_ffsll(~k);
+#else
+        while (k & 1) k >>= 1;
+        return k >> 1;
+#endif
+    }
+    size_t lower(const T& key) const { return descend([&](const T& node) { return cmp(node, key); }); }
+    size_t upper(const T& key) const { return descend([&](const T& node) { return !cmp(key, node); }); }
+
+public:
+    template <typename Iter>
+    Eytzinger(Iter begin, Iter end, Cmp c = Cmp{}) : a(std::distance(begin, end) + 1), n{a.size() - 1}, cmp(c) {
+        height = n ? Static_impl::floor_log2(n) + 1 : 0;
+        full = n ? (size_t{1} << (height - 1)) - 1 : 0;
+        for (size_t k = 1; k <= n; ++k) a[k] = begin[rank(k)];
+    }
+    template <typename Sequence>
+    explicit Eytzinger(const Sequence& c, Cmp cmp = Cmp{}) : Eytzinger(c.begin(), c.end(), cmp) {}
+
+    // rank of the first key not less than key, like std::lower_bound
+    size_t lower_bound(const T& key) const {
+        const size_t k {lower(key)};
+        return k ? rank(k) : n;
+    }
+    // rank of the first key greater than key
+    size_t upper_bound(const T& key) const {
+        const size_t k {upper(key)};
+        return k ? rank(k) : n;
+    }
+    std::pair<size_t, size_t> equal_range(const T& key) const { return {lower_bound(key), upper_bound(key)}; }
+    // rank of a key equal to key, n if there's none (like bin_search)
+    size_t find(const T& key) const {
+        const size_t k {lower(key)};
+        return k && !cmp(key, a[k]) ? rank(k) : n;
+    }
+    bool contains(const T& key) const { return find(key) != n; }
+
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+};
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>	// min, max
+#include <cstddef>		// ptrdiff_t
+#include <cstdio>		// FILE, fopen, fread
+#include <stdexcept>	// runtime_error
+#include <string>
+#include <vector>
+#include "string_search.h"
+#include "aho_corasick.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>		// open
+#include <sys/mman.h>	// mmap, madvise
+#include <sys/stat.h>	// fstat
+#include <unistd.h>		// close
+#define SAL_MMAP
+#endif
+
+namespace sal {
+
+// substring search over text that arrives in pieces, ex. a reader's buffers or a file too big for a string
+// matches are reported at their offset from the start of the stream, including ones spanning chunks:
+// a single pattern keeps the last pattern length - 1 bytes of the stream, the rest goes straight to String_searcher
+// (an Aho_corasick keeps its own state, see Aho_corasick::State)
+class Stream_searcher {
+    String_searcher searcher;
+    std::string carry;		// last m - 1 bytes so far, where a match spanning into the next chunk would start
+    std::string window;		// carry then the next chunk's first m - 1 bytes
+    size_t fed {0};			// bytes before the next chunk
+
+public:
+    explicit Stream_searcher(std::string pattern) : searcher{std::move(pattern)} {}
+
+    // f(offset) for every match ending in [begin, end), in order
+    template <typename F>
+    void feed(const char* begin, const char* end, F f) {
+        const size_t m {searcher.pattern().size()}, n = end - begin;
+        if (m == 0) { fed += n; return; }
+        const size_t keep {m - 1};
+        // matches starting in the carry are the spanning ones, they end in this chunk
+        if (!carry.empty()) {
+            window.assign(carry);
+            window.append(begin, std::min(n, keep));
+            const char* w {window.data()};
+            const size_t before {fed - carry.size()};
+            searcher.find_all(w, w + window.size(), [&](const char* match) {
+                if (match - w < static_cast<std::ptrdiff_t>(carry.size())) f(before + (match - w));
+            });
+        }
+        searcher.find_all(begin, end, [&](const char* match) { f(fed + (match - begin)); });
+        if (n >= keep) carry.assign(end - keep, end);
+        else {
+            carry.append(begin, end);
+            carry.erase(0, carry.size() > keep ? carry.size() - keep : 0);
+        }
+        fed += n;
+    }
+
+    // bytes fed so far
+    size_t position() const { return fed; }
+    const std::string& pattern() const { return searcher.pattern(); }
+    // to search another stream
+    void reset() { carry.clear(); fed = 0; }
+};
+
+// f(begin, end) over a file's bytes in order, chunk_bytes at a time through one buffer
+template <typename F>
+void for_each_chunk(std::FILE* file, F f, size_t chunk_bytes = size_t{1} << 24) {
+    std::vector<char> buf(std::max<size_t>(chunk_bytes, 1));
+    for (;;) {
+        const size_t len {std::fread(buf.data(), 1, buf.size(), file)};
+        if (std::ferror(file)) throw std::runtime_error("for_each_chunk: read failed");
+        if (len == 0) return;
+        f(static_cast<const char*>(buf.data()), static_cast<const char*>(buf.data() + len));
+    }
+}
+
+// the file mapped into memory where there's mmap (one call over the whole file, the page cache does the reading),
+// else read in chunks
+template <typename F>
+void for_each_chunk(const std::string& path, F f, size_t chunk_bytes = size_t{1} << 24) {
+#if defined(SAL_MMAP)
+    const int fd {::open(path.c_str(), O_RDONLY)};
+    if (fd < 0) throw std::runtime_error("for_each_chunk: can't open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        const size_t size = st.st_size;
+        if (size == 0) { ::close(fd); return; }
+        void* map {::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+        ::close(fd);
+        if (map != MAP_FAILED) {
+            ::madvise(map, size, MADV_SEQUENTIAL);
+            struct Unmap {
+                void* p; size_t n;
+                ~Unmap() { ::munmap(p, n); }
+            } unmap {map, size};
+            const char* begin {static_cast<const char*>(map)};
+            f(begin, begin + size);
+            return;
+        }
+    }
+    else ::close(fd);
+#endif
+    std::FILE* file {std::fopen(path.c_str(), "rb")};
+    if (!file) throw std::runtime_error("for_each_chunk: can't open " + path);
+    struct Closer {
+        std::FILE* f;
+        ~Closer() { std::fclose(f); }
+    } closer {file};
+    for_each_chunk(file, f, chunk_bytes);
+}
+
+// f(offset) for every match of pattern in the file
+template <typename F>
+void search_file(const std::string& path, const std::string& pattern, F f, size_t chunk_bytes = size_t{1} << 24) {
+    Stream_searcher stream {pattern};
+    for_each_chunk(path, [&](const char* begin, const char* end) { stream.feed(begin, end, f); }, chunk_bytes);
+}
+// f(Aho_corasick::Match) for every match of any of the automaton's patterns in the file
+template <typename F>
+void search_file(const std::string& path, const Aho_corasick& ac, F f, size_t chunk_bytes = size_t{1} << 24) {
+    Aho_corasick::State state;
+    for_each_chunk(path, [&](const char* begin, const char* end) { state = ac.scan(begin, end, state, f); }, chunk_bytes);
+}
+
+inline size_t count_file(const std::string& path, const std::string& pattern) {
+    size_t matches {0};
+    search_file(path, pattern, [&matches](size_t) { ++matches; });
+    return matches;
+}
+
+}
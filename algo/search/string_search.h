@@ -1,6 +1,9 @@
 #pragma once
+#include <cstring>	// memchr, memcmp
 #include <iterator>	// advance
+#include <string>
 #include <vector>
+#include "simd_reduce.h"	// Reduce_impl::has_avx2, ctz
 namespace sal {
 
 // comparator for strings
@@ -68,4 +71,245 @@ typename Indexable::const_iterator sub_match(const Indexable& s, const Indexable
 
 
 
+// precompiled single pattern search over byte buffers, for the same pattern over lots of text (grep)
+// one byte is memchr; longer patterns scan 16 or 32 bytes at a time (SSE2, AVX2 picked at run time) for
+// where the pattern's two rarest bytes both line up, and only compare the pattern there
+// the scans count the bytes they compare: past a few per byte of text, long patterns switch to skipping
+// by Horspool shifts and short ones (or Horspool in turn) finish with KMP, so repetitive text and
+// patterns (aaaa...) stay O(n + m) without slowing the usual case
+// matches may overlap; the empty pattern matches nowhere
+namespace String_impl {
+
+constexpr size_t long_pattern {32};	// Horspool from this length when pairs are too common, else KMP
+constexpr size_t work_per_byte {4};	// bytes compared per byte of text before giving up on skipping
+
+// how common a byte is in text, logs and code; lower is rarer
+inline unsigned char byte_rank(unsigned char c) {
+    static const struct Ranks {
+        unsigned char rank[256];
+        Ranks() {
+            const char common[] {" etaoinsrhldcumfpgwybvkxjqz\n0.,12-:/_=ETAOINSRHLDCUMFPGWYBVKXJQZ3456789()\"'\t;[]<>{}"};
+            for (unsigned c = 0; c < 256; ++c) rank[c] = c >= 0x20 && c < 0x7f ? 32 : 0;	// other printables, then the rest
+            const size_t k {sizeof(common) - 1};
+            for (size_t i = 0; i < k; ++i) rank[static_cast<unsigned char>(common[i])] = static_cast<unsigned char>(255 - i);
+        }
+    } ranks;
+    return ranks.rank[c];
+}
+
+// two positions in the pattern to look for first, the rarest byte and the rarest of the others
+struct Pair {
+    unsigned char b1, b2;
+    size_t i1, i2;
+};
+inline Pair rare_pair(const char* w, size_t m) {
+    auto rank = [w](size_t i) { return byte_rank(static_cast<unsigned char>(w[i])); };
+    size_t i1 {0};
+    for (size_t i = 1; i < m; ++i) if (rank(i) < rank(i1)) i1 = i;
+    size_t i2 = i1 ? 0 : 1;
+    for (size_t i = 0; i < m; ++i) {
+        if (i == i1) continue;
+        // a different byte from the first filters more than a second copy of it
+        const bool differs {w[i] != w[i1]}, best_differs {w[i2] != w[i1]};
+        if ((differs && !best_differs) || (differs == best_differs && rank(i) < rank(i2))) i2 = i;
+    }
+    return {static_cast<unsigned char>(w[i1]), static_cast<unsigned char>(w[i2]), i1, i2};
+}
+
+// first p in [from, last] with s[p + i1] == b1 and s[p + i2] == b2, last + 1 if none
+// reads no further than s[last + max(i1, i2)]
+inline size_t pair_find_scalar(const char* s, size_t from, size_t last, const Pair& pr) {
+    for (size_t p = from; p <= last; ++p)
+        if (static_cast<unsigned char>(s[p + pr.i1]) == pr.b1 && static_cast<unsigned char>(s[p + pr.i2]) == pr.b2) return p;
+    return last + 1;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"	// vectors passed between the inlined AVX2 helpers
+#endif
+
+#if defined(__SSE2__) || defined(SAL_REDUCE_AVX2)
+template <typename Ops>
+inline size_t pair_find_kernel(const char* s, size_t from, size_t last, const Pair& pr) {
+    constexpr size_t w {Ops::width};
+    const typename Ops::Vec v1 {Ops::set1(static_cast<char>(pr.b1))}, v2 {Ops::set1(static_cast<char>(pr.b2))};
+    size_t p {from};
+    for (; p + w - 1 <= last; p += w) {
+        const unsigned mask {Ops::eq(Ops::load(s + p + pr.i1), v1) & Ops::eq(Ops::load(s + p + pr.i2), v2)};
+        if (mask) return p + Reduce_impl::ctz(mask);
+    }
+    if (p > last) return last + 1;
+    // fewer than a block left: one more block ending at last, ignoring the positions already looked at
+    if (last - from + 1 < w) return pair_find_scalar(s, p, last, pr);
+    const size_t q {last + 1 - w};
+    const unsigned mask {(Ops::eq(Ops::load(s + q + pr.i1), v1) & Ops::eq(Ops::load(s + q + pr.i2), v2)) >> (p - q)};
+    return mask ? p + Reduce_impl::ctz(mask) : last + 1;
+}
+#endif
+
+#if defined(__SSE2__)
+struct Sse2_bytes {
+    static constexpr size_t width {16};
+    using Vec = __m128i;
+    static Vec load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static Vec set1(char c) { return _mm_set1_epi8(c); }
+    static unsigned eq(Vec a, Vec b) { return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)); }
+};
+inline size_t pair_find_sse2(const char* s, size_t from, size_t last, const Pair& pr) {
+    return pair_find_kernel<Sse2_bytes>(s, from, last, pr);
+}
+#endif
+
+#if defined(SAL_REDUCE_AVX2)
+struct Avx2_bytes {
+    static constexpr size_t width {32};
+    using Vec = __m256i;
+    SAL_AVX2_TARGET static Vec load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    SAL_AVX2_TARGET static Vec set1(char c) { return _mm256_set1_epi8(c); }
+    SAL_AVX2_TARGET static unsigned eq(Vec a, Vec b) { return _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)); }
+};
+__attribute__((target("avx2"), flatten))
+inline size_t pair_find_avx2(const char* s, size_t from, size_t last, const Pair& pr) {
+    return pair_find_kernel<Avx2_bytes>(s, from, last, pr);
+}
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+using Pair_find = size_t (*)(const char*, size_t, size_t, const Pair&);
+inline Pair_find choose_pair_find() {
+#if defined(SAL_REDUCE_AVX2)
+    if (Reduce_impl::has_avx2()) return pair_find_avx2;
+#endif
+#if defined(__SSE2__)
+    return pair_find_sse2;
+#else
+    return pair_find_scalar;
+#endif
+}
+
+}	// end namespace String_impl
+
+class String_searcher {
+    std::string w;
+    String_impl::Pair pair {};
+    String_impl::Pair_find pair_find {nullptr};
+    std::vector<size_t> shift;		// Horspool: how far the window moves by its last byte
+    std::vector<size_t> border;		// KMP: longest proper border of w[0, i]
+
+    // compared more than work_per_byte bytes per byte of text since from (with slack for a few verifies)
+    bool too_much(size_t work, size_t from, size_t p) const {
+        return work > String_impl::work_per_byte * (p - from) + 4 * w.size();
+    }
+
+    // each scan gets f(match) for every match from s + from while f returns true, returns where it stopped or s + n
+    // with no partial match carried in
+    template <typename F>
+    const char* kmp(const char* s, size_t from, size_t n, F& f) const {
+        const size_t m {w.size()};
+        size_t k {0};
+        for (size_t i = from; i < n; ++i) {
+            while (k && s[i] != w[k]) k = border[k - 1];
+            if (s[i] == w[k]) ++k;
+            if (k == m) {
+                if (!f(s + i + 1 - m)) return s + i + 1 - m;
+                k = border[m - 1];
+            }
+        }
+        return s + n;
+    }
+
+    template <typename F>
+    const char* horspool(const char* s, size_t from, size_t n, F& f) const {
+        const size_t m {w.size()}, last {n - m};
+        const unsigned char tail {static_cast<unsigned char>(w[m - 1])};
+        size_t work {0};
+        for (size_t p = from; p <= last;) {
+            const unsigned char c {static_cast<unsigned char>(s[p + m - 1])};
+            if (c == tail) {
+                if (std::memcmp(s + p, w.data(), m - 1) == 0 && !f(s + p)) return s + p;
+                if (too_much(work += m, from, p)) return kmp(s, p + 1, n, f);
+            }
+            p += shift[c];
+        }
+        return s + n;
+    }
+
+    // when the pair turns out too common in this text, long patterns go on skipping with Horspool, short ones KMP
+    template <typename F>
+    const char* pairs(const char* s, size_t n, F& f) const {
+        const size_t m {w.size()}, last {n - m};
+        size_t work {0};
+        for (size_t p = 0; (p = pair_find(s, p, last, pair)) <= last; ++p) {
+            if (std::memcmp(s + p, w.data(), m) == 0 && !f(s + p)) return s + p;
+            if (too_much(work += m, 0, p))
+                return m >= String_impl::long_pattern ? horspool(s, p + 1, n, f) : kmp(s, p + 1, n, f);
+        }
+        return s + n;
+    }
+
+    template <typename F>
+    const char* scan(const char* begin, const char* end, F f) const {
+        const size_t n = end - begin, m {w.size()};
+        if (m == 0 || n < m) return end;
+        if (m == 1) {
+            for (const char* p = begin; (p = static_cast<const char*>(std::memchr(p, w[0], end - p))); ++p)
+                if (!f(p)) return p;
+            return end;
+        }
+        return pairs(begin, n, f);
+    }
+
+public:
+    explicit String_searcher(std::string pattern) : w{std::move(pattern)} {
+        const size_t m {w.size()};
+        if (m < 2) return;
+        pair = String_impl::rare_pair(w.data(), m);
+        pair_find = String_impl::choose_pair_find();
+        border.assign(m, 0);
+        for (size_t i = 1, k = 0; i < m; ++i) {
+            while (k && w[i] != w[k]) k = border[k - 1];
+            if (w[i] == w[k]) ++k;
+            border[i] = k;
+        }
+        if (m >= String_impl::long_pattern) {
+            shift.assign(256, m);
+            for (size_t i = 0; i + 1 < m; ++i) shift[static_cast<unsigned char>(w[i])] = m - 1 - i;
+        }
+    }
+
+    // first match in [begin, end), end if none
+    const char* find(const char* begin, const char* end) const {
+        return scan(begin, end, [](const char*) { return false; });
+    }
+    // offset of the first match at or after from, text.size() if none
+    size_t find(const std::string& text, size_t from = 0) const {
+        if (from >= text.size()) return text.size();
+        const char* begin {text.data()}, *end {begin + text.size()};
+        return find(begin + from, end) - begin;
+    }
+    // f(pointer to the match) for every match in order
+    template <typename F>
+    void find_all(const char* begin, const char* end, F f) const {
+        scan(begin, end, [&f](const char* match) { f(match); return true; });
+    }
+    std::vector<size_t> find_all(const std::string& text) const {
+        std::vector<size_t> offsets;
+        const char* begin {text.data()};
+        find_all(begin, begin + text.size(), [&offsets, begin](const char* match) { offsets.push_back(match - begin); });
+        return offsets;
+    }
+    size_t count(const char* begin, const char* end) const {
+        size_t matches {0};
+        find_all(begin, end, [&matches](const char*) { ++matches; });
+        return matches;
+    }
+    size_t count(const std::string& text) const { return count(text.data(), text.data() + text.size()); }
+
+    const std::string& pattern() const { return w; }
+};
+
 }
\ No newline at end of file
@@ -3,25 +3,60 @@ contact: johnsonzhong@hotmail.ca | johnsonzhong.me
 ------------------------
 sorting algorithms
 functions overloaded to also accept containers
+comparison sorts also take (begin, end, cmp) or (begin, end, cmp, proj), comparing proj(a) to proj(b)
+proj_cmp(cmp, proj)         -> comparator combining the two, for anywhere only a comparator fits
+
+sort(begin, end, cmp, hook)	adaptive, samples the input and picks one of the sorts below, not stable
+	hook(const Sort_decision&) gets the sample statistics, the kernel picked and the time spent
+sort_kernel_name(kernel)	-> name of the sort picked
 
 comparison sorts O(nlgn) optimal
 partition(begin, end) -> iterator to pivot after partitioning begin to end using center as pivot
 bub_sort(begin, end)
 lin_sort(begin, end)  	 linear insertion sort
 ins_sort(begin, end)  	 binary insertion sort
-mer_sort(begin, end)
-qck_sort(begin, end)
+mer_sort(begin, end)		 stable, bottom up with one buffer
+mer_sort(begin, end, cmp)
+par_mer_sort(begin, end, cmp, threads)	stable, chunks sorted then merged in parallel
+qck_sort(begin, end)		 pattern-defeating quicksort (pdq_sort), insertion sort on small ranges, heap sort fallback
+pdq_sort(begin, end, cmp)
 heap_sort(begin, end)
+small_sort(begin, end, cmp)	up to 32 elements, sorting networks (AVX2 register sort for primitive keys), not stable
+network_sort<N>(first, cmp)	compile time network for exactly N elements
 
 distribution sorts O(kn) optimal, works for integer like values, k is number of "digits"
 cnt_sort(begin, end, k)     k is range of digit's value
 cnt_sort(begin, end, k, op) op selects for what is a digit
+cnt_sort(begin, end)        offset by the minimum, range found in one pass; pdq_sort if too wide to count
+par_cnt_sort(begin, end, threads)	per thread histograms, stable
+Cnt_sorter<T> sorter(threads)	reusable, keeps its buffer and histogram; L2 sized tiles for wide ranges
+cnt_sort_inplace(begin, end, k, op)	American flag sort, no buffer, not stable
+cnt_sort_inplace(begin, end)	integral keys rewritten from counts
 rdx_sort(begin, end)
 rdx_sort(begin, end, bits)  sort up to consider of bits # of bits
+bucket_sort(begin, end, hash)	buckets then pdq_sort on each, hash maps keys to buckets in order
+bucket_sort(begin, end, hash, kernel, threads)	kernel sorts a bucket: Bucket_ins, Bucket_pdq, Bucket_rdx, Bucket_recursive
+Number_bucket_hash(begin, end, buckets)	even split of [min, max]
 
 hybrid sorts
 tim_sort(begin, end)
-pat_sort(begin, end)		takes a lot of patience to wait for it to sort...
+Timsort<Iter, Cmp> sorter	reusable, sorter(begin, end) keeps its merge buffer between calls
+sorter.peak()				most elements the merge buffer had to hold
+pat_sort(begin, end)		patience sort, piles merged with a loser tree, fast on nearly sorted input
+lis(begin, end, cmp) -> longest strictly increasing subsequence, O(nlgn) from patience piles
+lis_len(begin, end)
+lds(begin, end, cmp) -> longest strictly decreasing subsequence
+lds_len(begin, end)
+
+external sorts, for files larger than memory
+ext_sort<T>(in_path, out_path, cmp, config) -> Ext_sort_stats with bytes read/written, # runs and passes
+Ext_sort_config(memory, fan_in, temp_dir)
+
+merging sorted sequences, ranges is a vector of (begin, end) pairs
+multiway_merge(ranges, out, cmp)	stable loser tree merge, lgk comparisons per element
+par_multiway_merge(ranges, out, cmp, threads)	output split by co-ranking, each thread merges its slice
+co_rank(ranges, rank, cmp) -> # elements each range contributes to the first rank of the merge
+Loser_tree<Source, Cmp>		over any sources with empty(), front(), pop()
 
 */
 
@@ -30,6 +65,11 @@ pat_sort(begin, end)		takes a lot of patience to wait for it to sort...
 #include "sort/partition.h"			// partition
 #include "sort/simple_sorts.h"		// bubble and insertion sort
 #include "sort/comparison_sorts.h"	// merge, quick, and heap sort
+#include "sort/pdq_sort.h"			// pattern-defeating quicksort
+#include "sort/sorting_network.h"	// small fixed size sorts
 #include "sort/distribution_sorts.h"// counting and radix sort
 #include "sort/timsort.h"
-#include "sort/patience_sort.h"
\ No newline at end of file
+#include "sort/patience_sort.h"
+#include "sort/external_sort.h"
+#include "sort/multiway_merge.h"
+#include "sort/adaptive_sort.h"		// sort
\ No newline at end of file
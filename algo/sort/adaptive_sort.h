@@ -0,0 +1,232 @@
+#pragma once
+#include <algorithm>	// min, max
+#include <chrono>
+#include <cstdint>
+#include <functional>	// less
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "../macros.h"			// Iter_value, Iter_diff
+#include "projection.h"			// Cheap_cmp
+#include "sorting_network.h"	// small_sort
+#include "pdq_sort.h"
+#include "timsort.h"
+#include "distribution_sorts.h"	// cnt_sort_inplace, rdx_sort, bucket_sort
+#include "../search/simd_reduce.h"	// min_max
+
+namespace sal {
+
+// adaptive sort, looks at a sample of the input and hands it to whichever sal sort suits it
+// not stable, needs random access iterators
+// 1. up to 32 primitive keys: sorting network
+// 2. sampled windows mostly ascending or descending (runs): Timsort, linear on runs
+// 3. integers under <, range at most twice the size: counting sort rewriting keys in place
+// 4. 32 bit integers under < with many distinct values: radix sort
+// 5. floating point under < spread evenly enough: bucket sort with pdq_sort in each bucket
+// 6. anything else: pattern-defeating quicksort
+enum class Sort_kernel {small, tim, counting, radix, bucket, pdq};
+
+inline const char* sort_kernel_name(Sort_kernel k) {
+    switch (k) {
+        case Sort_kernel::small: return "small_sort";
+        case Sort_kernel::tim: return "tim_sort";
+        case Sort_kernel::counting: return "cnt_sort_inplace";
+        case Sort_kernel::radix: return "rdx_sort";
+        case Sort_kernel::bucket: return "bucket_sort";
+        default: return "pdq_sort";
+    }
+}
+
+// what the sample showed, what was picked, and how long each part took
+struct Sort_decision {
+    size_t n {0};
+    size_t sampled {0};			// adjacent pairs looked at for order
+    double ascending {0};		// fraction of sampled pairs in order
+    double descending {0};		// fraction of sampled pairs strictly out of order
+    double disorder {0};		// fraction of sampled pairs against their own window's direction
+    double unique {1};			// fraction of distinct values in a strided sample
+    double range {0};			// max - min + 1 for numeric keys under <, 0 if not looked at
+    Sort_kernel kernel {Sort_kernel::pdq};
+    double choose_us {0};		// sampling and deciding
+    double sort_us {0};			// inside the kernel
+};
+
+// default hook, ignores the decision and skips the timing
+struct No_sort_hook {
+    void operator()(const Sort_decision&) const {}
+};
+
+namespace Adaptive_impl {
+
+constexpr size_t windows {16};			// sampled windows of consecutive elements
+constexpr size_t window_len {16};
+constexpr size_t unique_sample {128};	// strided elements checked for duplicates
+constexpr double run_ratio {1.0 / 16};	// fewer pairs than this against the grain means runs
+constexpr size_t radix_min {1 << 12};	// below this pdq_sort keeps up with radix sort
+constexpr size_t bucket_min {1 << 16};
+constexpr size_t bucket_bins {16};		// sample histogram to reject skewed floats
+
+inline double micros_since(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t).count();
+}
+
+// fraction of in order and out of order adjacent pairs in evenly spaced windows
+// a window going against the grain is still a run (descending runs are reversed by Timsort),
+// so disorder counts only the minority direction inside each window
+template <typename Iter, typename Cmp>
+void sample_order(Iter begin, size_t n, Cmp& cmp, Sort_decision& d) {
+    size_t asc {0}, desc {0}, minority {0};
+    const size_t len {std::min(window_len, n)};
+    const size_t count {n <= windows * window_len ? 1 : windows};
+    const size_t stride {count > 1 ? (n - len) / (count - 1) : 0};
+    for (size_t w = 0; w < count; ++w) {
+        Iter first {begin + w * stride};
+        Iter last {count == 1 ? begin + n : first + len};
+        size_t w_desc {0}, pairs {0};
+        for (Iter cur = first; cur + 1 != last; ++cur, ++pairs)
+            w_desc += cmp(*(cur + 1), *cur);
+        asc += pairs - w_desc;
+        desc += w_desc;
+        minority += std::min(w_desc, pairs - w_desc);
+    }
+    d.sampled = asc + desc;
+    d.ascending = d.sampled ? (double)asc / d.sampled : 1;
+    d.descending = d.sampled ? (double)desc / d.sampled : 0;
+    d.disorder = d.sampled ? (double)minority / d.sampled : 0;
+}
+
+// the strided sample is sorted through iterators to it, so keys are never copied (and move-only keys work)
+template <typename Iter, typename Cmp>
+void sample_unique(Iter begin, size_t n, Cmp& cmp, Sort_decision& d) {
+    const size_t k {std::min(unique_sample, n)};
+    std::vector<Iter> s;
+    s.reserve(k);
+    for (size_t i = 0; i < k; ++i) s.push_back(begin + i * (n / k));
+    pdq_sort(s.begin(), s.end(), [&cmp](const Iter& a, const Iter& b) { return cmp(*a, *b); });
+    size_t distinct {k ? 1u : 0u};
+    for (size_t i = 1; i < k; ++i) distinct += cmp(*s[i-1], *s[i]);
+    d.unique = k ? (double)distinct / k : 1;
+}
+
+// whether the strided sample crowds into a few of bucket_bins even bins over [lo, hi]
+template <typename Iter, typename T>
+bool skewed(Iter begin, size_t n, T lo, T hi) {
+    const size_t k {std::min(unique_sample * 2, n)};
+    size_t bins[bucket_bins] {};
+    const double scale {(bucket_bins - 1) / ((double)hi - lo)};
+    for (size_t i = 0; i < k; ++i) ++bins[(size_t)((begin[i * (n / k)] - lo) * scale)];
+    return *std::max_element(bins, bins + bucket_bins) > 4 * k / bucket_bins;
+}
+
+template <typename T>
+struct Radix_ok {
+    static constexpr bool value = std::is_integral<T>::value && sizeof(T) == 4 &&
+        (std::is_unsigned<T>::value || std::is_same<T, int>::value);
+};
+// largest key rdx_sort works with, it shifts signed ints up by the minimum when that's negative
+template <typename T>
+long long radix_span(T lo, T hi) { return std::is_signed<T>::value ? (long long)hi - std::min<long long>(lo, 0) : hi; }
+
+// numeric stages, only for arithmetic keys under <
+template <typename Iter, typename Cmp>
+bool numeric(Iter, size_t, Sort_decision&, std::false_type) { return false; }
+template <typename Iter, typename Cmp>
+bool numeric(Iter begin, size_t n, Sort_decision& d, std::true_type) {
+    using T = Iter_value<Iter>;
+    auto mm = Reduce_impl::min_max(begin, begin + n);
+    const T lo {mm.first}, hi {mm.second};
+    d.range = (double)hi - lo + 1;
+    if (std::is_integral<T>::value) {
+        if (d.range <= 2.0 * n) { d.kernel = Sort_kernel::counting; return true; }
+        if (Radix_ok<T>::value && n >= radix_min && d.unique > 0.5 &&
+            radix_span(lo, hi) <= std::numeric_limits<int>::max()) { d.kernel = Sort_kernel::radix; return true; }
+        return false;
+    }
+    if (n >= bucket_min && lo < hi && d.range < std::numeric_limits<double>::infinity() && !skewed(begin, n, lo, hi)) {
+        d.kernel = Sort_kernel::bucket;
+        return true;
+    }
+    return false;
+}
+
+// passes as many bits as the offset keys need
+template <typename Iter>
+void radix(Iter begin, Iter end, std::true_type) {
+    using T = Iter_value<Iter>;
+    auto mm = Reduce_impl::min_max(begin, end);
+    unsigned long long span = radix_span<T>(mm.first, mm.second);
+    int bits {1};
+    while (span >>= 1) ++bits;
+    rdx_sort(begin, end, bits);
+}
+template <typename Iter>
+void radix(Iter, Iter, std::false_type) {}
+
+template <typename Iter>
+void counting(Iter begin, Iter end, std::true_type) { cnt_sort_inplace(begin, end); }
+template <typename Iter>
+void counting(Iter, Iter, std::false_type) {}
+
+template <typename Iter>
+void bucket(Iter begin, Iter end, std::true_type) {
+    bucket_sort(begin, end, Number_bucket_hash(begin, end, std::max<size_t>((end - begin) / 8, 1)), Bucket_pdq());
+}
+template <typename Iter>
+void bucket(Iter, Iter, std::false_type) {}
+
+template <typename Iter, typename Cmp>
+void small(Iter begin, Iter end, Cmp& cmp, std::true_type) { small_sort(begin, end, cmp); }
+template <typename Iter, typename Cmp>
+void small(Iter begin, Iter end, Cmp& cmp, std::false_type) { pdq_sort(begin, end, cmp); }
+
+}	// end namespace Adaptive_impl
+
+// hook(const Sort_decision&) is called after sorting, with timings unless it's No_sort_hook
+// std::sort is found through argument dependent lookup on std iterators, so call this one as sal::sort
+template <typename Iter, typename Cmp, typename Hook>
+void sort(Iter begin, Iter end, Cmp cmp, Hook hook) {
+    using namespace Adaptive_impl;
+    using T = Iter_value<Iter>;
+    constexpr bool timed {!std::is_same<Hook, No_sort_hook>::value};
+    constexpr bool primitive {std::is_arithmetic<T>::value && Cheap_cmp<Cmp, T>::value};
+    constexpr bool numeric_less {std::is_arithmetic<T>::value && std::is_same<Cmp, std::less<T>>::value};
+    using Int_less = std::integral_constant<bool, numeric_less && std::is_integral<T>::value>;
+
+    auto start = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+    Sort_decision d;
+    d.n = end - begin;
+
+    if (d.n <= Network_impl::small_max && primitive) d.kernel = Sort_kernel::small;
+    else if (d.n > Network_impl::small_max) {
+        sample_order(begin, d.n, cmp, d);
+        if (d.disorder <= run_ratio) d.kernel = Sort_kernel::tim;
+        else {
+            sample_unique(begin, d.n, cmp, d);
+            if (!numeric<Iter, Cmp>(begin, d.n, d, std::integral_constant<bool, numeric_less>{}))
+                d.kernel = Sort_kernel::pdq;
+        }
+    }
+
+    if (timed) {
+        d.choose_us = micros_since(start);
+        start = std::chrono::steady_clock::now();
+    }
+    switch (d.kernel) {
+        case Sort_kernel::small: small(begin, end, cmp, std::integral_constant<bool, primitive>{}); break;
+        case Sort_kernel::tim: tim_sort(begin, end, cmp); break;
+        case Sort_kernel::counting: counting(begin, end, Int_less{}); break;
+        case Sort_kernel::radix: radix(begin, end, std::integral_constant<bool, Int_less::value && Radix_ok<T>::value>{}); break;
+        case Sort_kernel::bucket: bucket(begin, end, std::integral_constant<bool, numeric_less && !Int_less::value>{}); break;
+        default: pdq_sort(begin, end, cmp); break;
+    }
+    if (timed) d.sort_us = micros_since(start);
+    hook(d);
+}
+template <typename Iter, typename Cmp>
+void sort(Iter begin, Iter end, Cmp cmp) { sal::sort(begin, end, cmp, No_sort_hook()); }
+template <typename Iter>
+void sort(Iter begin, Iter end) { sal::sort(begin, end, std::less<Iter_value<Iter>>()); }
+template <typename Container>
+void sort(Container& c) { sal::sort(c.begin(), c.end()); }
+
+}
\ No newline at end of file
@@ -1,39 +1,150 @@
 #pragma once
-#include <limits>
+#include <algorithm>	// min, move
+#include <functional>	// less
+#include <iterator>		// back_inserter, make_move_iterator
+#include <thread>
+#include <type_traits>	// integral_constant
 #include <vector>
+#include "../macros.h"		// Iter_value, Iter_diff
+#include "simple_sorts.h"	// lin_sort
+#include "sorting_network.h"	// small_sort
+#include "projection.h"		// Ties_indistinct
+#include "pdq_sort.h"
 
 namespace sal {
 
-// Merge sort O(nlogn) time O(n) space
-template <typename Iter>
-void merge(Iter begin, Iter middle, Iter last) {
-    using T = typename Iter::value_type;
-    std::vector<T> left(begin, middle + 1);
-    std::vector<T> right(middle + 1, last + 1);
-    left.push_back(std::numeric_limits<T>::max()); // sentinel
-    right.push_back(std::numeric_limits<T>::max());
-    for (int i = 0, j = 0, k = 0; k <= last - begin; ++k) {
-        if (left[i] < right[j]) begin[k] = left[i++];
-        else begin[k] = right[j++];
+namespace Merge_impl {
+
+constexpr long run_size {32};	// base runs are insertion sorted, or network sorted for integers
+constexpr long parallel_cutoff {1 << 14};	// # elements per thread before threads pay off
+
+// stable merge of sorted [a, a_end) and [b, b_end) into out, ties taken from a
+template <typename In, typename Out, typename Cmp>
+Out merge_into(In a, In a_end, In b, In b_end, Out out, Cmp cmp) {
+    while (a != a_end && b != b_end) {
+        if (cmp(*b, *a)) *out++ = std::move(*b++);
+        else *out++ = std::move(*a++);
     }
+    out = std::move(a, a_end, out);
+    return std::move(b, b_end, out);
 }
-template <typename Iter>
-void merge_helper(Iter begin, Iter last) {
-    if (begin < last) {
-        Iter pivot = begin + (last - begin)/2;   // half way point rounded down
-        merge_helper(begin, pivot);
-        merge_helper(pivot + 1, last);
-        merge(begin, pivot, last);
+
+// merge each adjacent pair of sorted runs of length width in [first, last) into out
+template <typename In, typename Out, typename Cmp>
+void merge_level(In first, In last, Out out, Iter_diff<In> width, Cmp cmp) {
+    for (auto left = last - first; left > 0;) {
+        auto len_a = std::min(width, left);
+        auto len_b = std::min(width, left - len_a);
+        out = merge_into(first, first + len_a, first + len_a, first + (len_a + len_b), out, cmp);
+        first += len_a + len_b;
+        left -= len_a + len_b;
     }
 }
-template <typename Iter>
-void mer_sort(Iter begin, Iter end) {
-    merge_helper(begin, end - 1);
+
+// merge runs of width from src into dst, then dst back into src, etc. until one run is left
+// returns true if the result ended up in dst
+template <typename Src, typename Dst, typename Cmp>
+bool merge_passes(Src src, Src src_end, Dst dst, Iter_diff<Src> width, Cmp cmp) {
+    const auto n = src_end - src;
+    bool in_dst {false};
+    for (; width < n; width *= 2) {
+        if (in_dst) merge_level(dst, dst + n, src, width, cmp);
+        else merge_level(src, src_end, dst, width, cmp);
+        in_dst = !in_dst;
+    }
+    return in_dst;
+}
+
+template <typename Iter, typename Cmp>
+void sort_run(Iter run, Iter run_end, Cmp cmp, std::true_type) { small_sort(run, run_end, cmp); }
+template <typename Iter, typename Cmp>
+void sort_run(Iter run, Iter run_end, Cmp cmp, std::false_type) { lin_sort(run, run_end, run, cmp); }
+
+template <typename Iter, typename Cmp>
+void sort_runs(Iter begin, Iter end, Cmp cmp) {
+    for (Iter run = begin; run != end;) {
+        Iter run_end {run + std::min<Iter_diff<Iter>>(run_size, end - run)};
+        sort_run(run, run_end, cmp, std::integral_constant<bool, Ties_indistinct<Cmp, Iter_value<Iter>>::value>{});
+        run = run_end;
+    }
+}
+
+}	// end namespace Merge_impl
+
+// Merge sort O(nlgn) time O(n) space, stable
+// bottom up: insertion sort short runs, then merge pairs of runs level by level
+// one buffer for the whole sort, each level merges from the array into the buffer or back
+template <typename Iter, typename Cmp>
+void mer_sort(Iter begin, Iter end, Cmp cmp) {
+    using namespace Merge_impl;
+    const auto n = end - begin;
+    sort_runs(begin, end, cmp);
+    if (n <= run_size) return;
+    // the first level builds the buffer by moving into it, so T needs no default constructor
+    std::vector<Iter_value<Iter>> buf;
+    buf.reserve(n);
+    merge_level(begin, end, std::back_inserter(buf), run_size, cmp);
+    if (!merge_passes(buf.begin(), buf.end(), begin, 2 * run_size, cmp))
+        std::move(buf.begin(), buf.end(), begin);
 }
+template <typename Iter, typename Cmp, typename Proj>
+void mer_sort(Iter begin, Iter end, Cmp cmp, Proj proj) { mer_sort(begin, end, proj_cmp(cmp, proj)); }
+template <typename Iter>
+void mer_sort(Iter begin, Iter end) { mer_sort(begin, end, std::less<Iter_value<Iter>>()); }
 template <typename Container>
 void mer_sort(Container& c) { mer_sort(c.begin(), c.end()); }
 
+// parallel merge sort, still stable; threads = 0 uses every hardware thread
+// to sort by a projection pass proj_cmp(cmp, proj) as the comparator
+// each thread sorts a chunk, then adjacent chunks are merged pairwise in parallel
+template <typename Iter, typename Cmp>
+void par_mer_sort(Iter begin, Iter end, Cmp cmp, unsigned threads = 0) {
+    using namespace Merge_impl;
+    using D = Iter_diff<Iter>;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    const D n {end - begin};
+    if (threads < 2 || n < (D)threads * parallel_cutoff) { mer_sort(begin, end, cmp); return; }
+
+    // buffer takes the data, the array is the scratch space while chunks get sorted
+    std::vector<Iter_value<Iter>> buf(std::make_move_iterator(begin), std::make_move_iterator(end));
+    std::vector<D> bounds;
+    for (unsigned t = 0; t <= threads; ++t) bounds.push_back(n * t / threads);
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t)
+        workers.emplace_back([&, t]() {
+            auto first = buf.begin() + bounds[t], last = buf.begin() + bounds[t+1];
+            sort_runs(first, last, cmp);
+            if (merge_passes(first, last, begin + bounds[t], run_size, cmp))
+                std::move(begin + bounds[t], begin + bounds[t+1], first);
+        });
+    for (auto& w : workers) w.join();
+
+    // merge adjacent chunks level by level, alternating between buffer and array
+    bool in_buf {true};
+    while (bounds.size() > 2) {
+        std::vector<D> merged;
+        workers.clear();
+        for (size_t c = 0; c + 1 < bounds.size(); c += 2) {
+            merged.push_back(bounds[c]);
+            D lo {bounds[c]}, mid {bounds[c+1]}, hi {bounds[std::min(c+2, bounds.size()-1)]};
+            workers.emplace_back([&, lo, mid, hi]() {
+                if (in_buf) merge_into(buf.begin() + lo, buf.begin() + mid, buf.begin() + mid, buf.begin() + hi, begin + lo, cmp);
+                else merge_into(begin + lo, begin + mid, begin + mid, begin + hi, buf.begin() + lo, cmp);
+            });
+        }
+        merged.push_back(n);
+        for (auto& w : workers) w.join();
+        bounds.swap(merged);
+        in_buf = !in_buf;
+    }
+    if (in_buf) std::move(buf.begin(), buf.end(), begin);
+}
+template <typename Iter>
+void par_mer_sort(Iter begin, Iter end) { par_mer_sort(begin, end, std::less<Iter_value<Iter>>()); }
+
 // Quick sort O(nlgn) time O(n) space sorts [begin, last]
+// plain version for learning, middle pivot can go quadratic and recurse deeply on patterned input
 template <typename Iter>
 void quick_sort(Iter begin, Iter last) {
     if (last - begin > 0) {
@@ -49,21 +160,30 @@ void quick_sort(Iter begin, Iter last) {
         quick_sort(left, last);
     }
 }
-template <typename Iter>
-void qck_sort(Iter begin, Iter end) {
-    quick_sort(begin, end - 1);
+// pattern-defeating quicksort, O(nlgn) worst case and O(n) on sorted input
+template <typename Iter, typename Cmp>
+void qck_sort(Iter begin, Iter end, Cmp cmp) {
+    pdq_sort(begin, end, cmp);
 }
+template <typename Iter, typename Cmp, typename Proj>
+void qck_sort(Iter begin, Iter end, Cmp cmp, Proj proj) { pdq_sort(begin, end, proj_cmp(cmp, proj)); }
+template <typename Iter>
+void qck_sort(Iter begin, Iter end) { pdq_sort(begin, end); }
 template <typename Container>
 void qck_sort(Container& c) { qck_sort(c.begin(), c.end()); }
 
-template <typename Iter>
-void heap_sort(Iter begin, Iter end) {
-    make_heap(begin, end);
-    sort_heap(begin, end);
+template <typename Iter, typename Cmp>
+void heap_sort(Iter begin, Iter end, Cmp cmp) {
+    std::make_heap(begin, end, cmp);
+    std::sort_heap(begin, end, cmp);
     // sort heap puts the root (largest elem) at the back
     // then considers the heap as [begin, end-1)
     // max_heapify root and proceed in loop
 }
+template <typename Iter, typename Cmp, typename Proj>
+void heap_sort(Iter begin, Iter end, Cmp cmp, Proj proj) { heap_sort(begin, end, proj_cmp(cmp, proj)); }
+template <typename Iter>
+void heap_sort(Iter begin, Iter end) { heap_sort(begin, end, std::less<Iter_value<Iter>>()); }
 template <typename Container>
 void heap_sort(Container& c) { heap_sort(c.begin(), c.end()); }
 
@@ -1,43 +1,205 @@
 #pragma once
 #include <climits>
+#include <cstdint>
 #include <iterator>
 #include <algorithm>
+#include <thread>
+#include <type_traits>	// make_unsigned
 #include <vector>
-#include "../search/element_select.h"	// min_max
 #include "../macros.h"	// Iter_value
 #include "simple_sorts.h"	// lin_sort
+#include "pdq_sort.h"		// pdq_sort
+#include "../search/simd_reduce.h"	// min_max
 
 namespace sal {
 
-// counting sort, assumes each input is integral between 0 to k
-// O(n) if k = O(n)
+// counting sort, stable, O(n + k) for keys in [0, k)
+// a Cnt_sorter keeps its histogram and scratch buffer between sorts (radix sort reuses one per digit)
+// counters are 32 bit unless there are 2^32 or more elements
+// a histogram bigger than l2_bytes is tiled: one pass splits by the key's high bits into tiles whose
+// histograms fit in L2, a second pass counting sorts each tile on the low bits
+// with threads, each thread counts its slice into its own histogram and scatters it to its own offsets
+namespace Cnt_impl {
+
+constexpr size_t l2_bytes {1 << 18};			// histogram budget
+constexpr size_t parallel_cutoff {1 << 16};		// # elements per thread before threads pay off
+
+inline unsigned pick_threads(unsigned threads, size_t n) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, n / parallel_cutoff)));
+}
+
+// f(t) for t in [0, threads), on threads - 1 new threads and this one
+template <typename F>
+void on_threads(unsigned threads, F f) {
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) workers.emplace_back(f, t);
+    f(0);
+    for (auto& w : workers) w.join();
+}
+
+// one stable counting pass of n elements from in to out on key(v) in [0, buckets)
+// bounds gets the start of every bucket in out, plus n at the end
+template <typename Count, typename In, typename Out, typename Key>
+void scatter(In in, size_t n, Out out, Key key, size_t buckets, std::vector<Count>& counts,
+             std::vector<size_t>& bounds, unsigned threads) {
+    counts.assign(buckets * threads, 0);
+    bounds.resize(buckets + 1);
+    auto slice = [n, threads](unsigned t) { return n * t / threads; };
+
+    on_threads(threads, [&](unsigned t) {
+        Count* hist {&counts[t * buckets]};
+        for (size_t i = slice(t), last = slice(t + 1); i != last; ++i) ++hist[key(in[i])];
+    });
+
+    // bucket major, thread minor, so thread t's part of bucket b follows the threads before it
+    size_t sum {0};
+    for (size_t b = 0; b < buckets; ++b) {
+        bounds[b] = sum;
+        for (unsigned t = 0; t < threads; ++t) {
+            Count c {counts[t * buckets + b]};
+            counts[t * buckets + b] = static_cast<Count>(sum);
+            sum += c;
+        }
+    }
+    bounds[buckets] = sum;
+
+    on_threads(threads, [&](unsigned t) {
+        Count* next {&counts[t * buckets]};
+        for (size_t i = slice(t), last = slice(t + 1); i != last; ++i) out[next[key(in[i])]++] = in[i];
+    });
+}
+
+// v's key above lo, an unsigned difference so signed values far apart don't overflow
+template <typename T>
+size_t offset(T v, T lo) {
+    using U = typename std::make_unsigned<T>::type;
+    return static_cast<size_t>(static_cast<U>(static_cast<U>(v) - static_cast<U>(lo)));
+}
+// keys spanning [0, span] are worth counting for n elements: past a few buckets per element
+// (or a span whose + 1 doesn't fit) comparison sorting is cheaper than clearing the histogram
+constexpr size_t buckets_per_element {4};
+inline bool countable(size_t span, size_t n) { return span < buckets_per_element * n + parallel_cutoff; }
+
+inline unsigned log2(size_t n) {
+    unsigned log {0};
+    while (n >>= 1) ++log;
+    return log;
+}
+
+}	// end namespace Cnt_impl
+
+template <typename T>
+class Cnt_sorter {
+    std::vector<T> buf;
+    std::vector<uint32_t> counts32;
+    std::vector<uint64_t> counts64;
+    std::vector<size_t> tiles, bounds;
+    unsigned threads;
+
+    template <typename Count, typename Iter, typename Op>
+    void sort(Iter begin, size_t n, size_t range, Op op, std::vector<Count>& counts) {
+        using namespace Cnt_impl;
+        const unsigned th {pick_threads(threads, n)};
+        buf.resize(n);
+        if (range * sizeof(Count) * th <= l2_bytes || range <= 256) {
+            scatter(begin, n, buf.begin(), op, range, counts, bounds, th);
+            std::copy(buf.begin(), buf.end(), begin);
+            return;
+        }
+        const unsigned tile_bits {log2(l2_bytes / sizeof(Count))};
+        const size_t tile_mask {(size_t{1} << tile_bits) - 1};
+        scatter(begin, n, buf.begin(), [&op, tile_bits](const T& v) { return static_cast<size_t>(op(v)) >> tile_bits; },
+                ((range - 1) >> tile_bits) + 1, counts, tiles, th);
+        auto low = [&op, tile_mask](const T& v) { return static_cast<size_t>(op(v)) & tile_mask; };
+        for (size_t t = 0; t + 1 < tiles.size(); ++t) {
+            const size_t len {tiles[t+1] - tiles[t]};
+            if (len == 0) continue;
+            scatter(buf.begin() + tiles[t], len, begin + tiles[t], low,
+                    std::min(tile_mask + 1, range - (t << tile_bits)), counts, bounds, pick_threads(threads, len));
+        }
+    }
+public:
+    // threads = 0 uses all hardware threads, small inputs stay on one thread either way
+    explicit Cnt_sorter(unsigned th = 1) : threads{th} {}
+
+    // op(v) is v's key in [0, range)
+    template <typename Iter, typename Op>
+    void operator()(Iter begin, Iter end, size_t range, Op op) {
+        const size_t n = end - begin;
+        if (n < 2 || range < 2) return;
+        if (n <= UINT32_MAX) sort(begin, n, range, op, counts32);
+        else sort(begin, n, range, op, counts64);
+    }
+    // integral values, keys are offset by the minimum so the range is max - min + 1
+    // values spread too wide for a histogram are pdq sorted instead
+    template <typename Iter>
+    void operator()(Iter begin, Iter end) {
+        if (end - begin < 2) return;
+        auto mm = Reduce_impl::min_max(begin, end);
+        const T lo {mm.first};
+        const size_t span {Cnt_impl::offset(mm.second, lo)};
+        if (!Cnt_impl::countable(span, end - begin)) return pdq_sort(begin, end);
+        (*this)(begin, end, span + 1, [lo](const T& v) { return Cnt_impl::offset(v, lo); });
+    }
+    // give back the buffer and histograms
+    void release() {
+        std::vector<T>().swap(buf);
+        std::vector<uint32_t>().swap(counts32);
+        std::vector<uint64_t>().swap(counts64);
+    }
+};
+
+// one-off sorts, op(v) in [0, range)
 template <typename Iter, typename Op>
 void cnt_sort(Iter begin, Iter end, size_t range, Op op) {
-    using T = typename Iter::value_type;
-    std::vector<int> counts(range);   // init to 0
-    for (auto i = begin; i != end; ++i) // count # elems == i
-        ++counts[op(*i)]; 
-    for (size_t i = 1; i < range; ++i)
-        counts[i] += counts[i-1];   // turn into # elems <= i
-    std::vector<T> res(end - begin);
-    for (auto j = end;;) {
-        --j;
-        res[--counts[op(*j)]] = *j;
-        if (j == begin) break;
-    }
-    std::copy(res.begin(), res.end(), begin);
+    Cnt_sorter<Iter_value<Iter>>{}(begin, end, range, op);
 }
 template <typename Iter>
 void cnt_sort(Iter begin, Iter end, size_t range = 0) {
-	// no range specified requires one pass through the data to find the maximum
-	if (range == 0) {
-		auto mm_pair = min_max(begin, end);
-		range = mm_pair.second - mm_pair.first;
-	}
-    cnt_sort(begin, end, range, [](typename Iter::value_type v){return v;});
+    // no range specified requires one pass through the data to find the minimum and maximum
+    if (range == 0) Cnt_sorter<Iter_value<Iter>>{}(begin, end);
+    else cnt_sort(begin, end, range, [](Iter_value<Iter> v){return static_cast<size_t>(v);});
 }
 template <typename Container>
 void cnt_sort(Container& c, size_t range) { cnt_sort(c.begin(), c.end(), range); }
+// counting on all hardware threads
+template <typename Iter>
+void par_cnt_sort(Iter begin, Iter end, unsigned threads = 0) { Cnt_sorter<Iter_value<Iter>>{threads}(begin, end); }
+
+// in place, no scratch buffer, not stable
+// American flag sort: count, then swap each element straight into the next free slot of its bucket
+template <typename Iter, typename Op>
+void cnt_sort_inplace(Iter begin, Iter end, size_t range, Op op) {
+    const size_t n = end - begin;
+    if (n < 2) return;
+    std::vector<size_t> next(range + 1), last(range);
+    for (auto cur = begin; cur != end; ++cur) ++next[op(*cur) + 1];
+    for (size_t b = 1; b <= range; ++b) next[b] += next[b-1];
+    std::copy(next.begin() + 1, next.end(), last.begin());
+    for (size_t b = 0; b < range; ++b) {
+        while (next[b] < last[b]) {
+            size_t k = op(begin[next[b]]);
+            if (k == b) ++next[b];
+            else std::swap(begin[next[b]], begin[next[k]++]);
+        }
+    }
+}
+// integral keys alone carry no other data, so they're rewritten from the counts
+// (pdq sorted if they're spread too wide for a histogram)
+template <typename Iter>
+void cnt_sort_inplace(Iter begin, Iter end) {
+    using T = Iter_value<Iter>;
+    if (end - begin < 2) return;
+    auto mm = Reduce_impl::min_max(begin, end);
+    const T lo {mm.first};
+    const size_t span {Cnt_impl::offset(mm.second, lo)};
+    if (!Cnt_impl::countable(span, end - begin)) return pdq_sort(begin, end);
+    std::vector<size_t> counts(span + 1);
+    for (auto cur = begin; cur != end; ++cur) ++counts[Cnt_impl::offset(*cur, lo)];
+    for (size_t k = 0; k < counts.size(); ++k)
+        begin = std::fill_n(begin, counts[k], static_cast<T>(lo + k));
+}
 
 // radix sort, more practical than counting sort
 // O(d(n + k)) running time where d is # digits, k is size of digit
@@ -77,10 +239,11 @@ struct rdx_impl {
 	    // most efficent (theoretically) when digits are base n, having lg(n) bits
 	    constexpr size_t digit_bits {8};		// # bits in digit, 8 works well for 32 and 64 bit vals
 
+	    Cnt_sorter<T> sorter;			// buffer reused between digits
 	    size_t d {0};                   // current digit #
 	    for (long long mask = (1 << digit_bits) - 1;
 	    	d * digit_bits < bits;) {// ex. 0x000000ff for setting lower 8 bits on 32 bit num
-	        cnt_sort(begin, end, range, Digit_cmp<T>(mask, digit_bits*d));
+	        sorter(begin, end, range, Digit_cmp<T>(mask, digit_bits*d));
 	        ++d;
 	    }
 	}
@@ -97,10 +260,11 @@ struct rdx_impl<Iter, int> {
 
 	    constexpr size_t digit_bits {8};		// # bits in digit, 8 works well for 32 and 64 bit vals
 
+	    Cnt_sorter<int> sorter;
 	    size_t d {0};                   // current digit #
 	    for (long long mask = (1 << digit_bits) - 1;
 	    	d * digit_bits < bits;) {// ex. 0x000000ff for setting lower 8 bits on 32 bit num
-	        cnt_sort(begin, end, 256, Digit_cmp<int>(mask, digit_bits*d));
+	        sorter(begin, end, 256, Digit_cmp<int>(mask, digit_bits*d));
 	        ++d;
 	    }	
 
@@ -114,10 +278,11 @@ template <typename Iter>
 struct rdx_impl<Iter, std::string> {	// enough to hold ASCII char range
 	static void rdx_sort(Iter begin, Iter end, size_t) {
 		// ignore additional int argument
-		int len_max = {};
-		for (auto str = begin; str != std::endl; ++str) len_max = max(len_max, str->size());
-		for (int d = len_max - 1; d >= 0; --d)
-			cnt_sort(begin, end, 128, Digit_cmp<std::string>(d));
+		size_t len_max {};
+		for (auto str = begin; str != end; ++str) len_max = std::max(len_max, str->size());
+		Cnt_sorter<std::string> sorter;
+		for (size_t d = len_max; d-- > 0;)
+			sorter(begin, end, 128, Digit_cmp<std::string>(d));
 	}
 };
 
@@ -154,73 +319,137 @@ void rdx_sort(Container& c) { rdx_sort(c.begin(), c.end()); }
 
 
 
-// bucket sort in O(n) with std::sort for sorting on individual buckets
-// hash must have size_t size() = #buckets; size_t operator(const T&) = bucket for object 
-template <typename Iter, typename Hash>
-void bucket_sort(Iter begin, const Iter end, Hash&& hash) {
-	using T = typename std::iterator_traits<Iter>::value_type;
-	std::vector<std::vector<T>> buckets(hash.size());
-	// scatter into buckets
-	for (auto cur = std::make_move_iterator(begin); cur != std::make_move_iterator(end); ++cur) {
-		size_t b {hash(*cur)};
-		std::cout << b << ' ' << *cur << std::endl;
-		buckets[b].emplace_back(*cur);	// moved
-	}
-	// sort each bucket separately
-	for (auto& bucket : buckets)
-		std::sort(bucket.begin(), bucket.end());
-	// gather back into original container
-	for (auto& bucket : buckets) {
-		for (auto cur = std::make_move_iterator(bucket.begin());
-			  cur != std::make_move_iterator(bucket.end()); ++cur) {
-			*begin = *cur;	// move back
-			++begin;
-		}
-	}
-}
-
-// insertion sort is O(nk) where k is supposed to be small after bucketing
-// sorting after putting back into container allows better locality, but requires comparison
-template <typename Iter, typename Hash>
-void bucket_ins_sort(Iter begin, const Iter end, Hash&& hash) {
-	using T = typename std::iterator_traits<Iter>::value_type;
-	std::vector<std::vector<T>> buckets(hash.size());
-	// scatter into buckets
-	for (auto cur = std::make_move_iterator(begin); cur != std::make_move_iterator(end); ++cur) {
-		size_t b {hash(*cur)};
-		std::cout << b << ' ' << *cur << std::endl;
-		buckets[b].emplace_back(*cur);	// moved
-	}
-	// gather unsorted elements back into array
-	auto beg = begin;
-	for (auto& bucket : buckets) {
-		for (auto cur = std::make_move_iterator(bucket.begin());
-			  cur != std::make_move_iterator(bucket.end()); ++cur) {
-			*beg = *cur;	// move back
-			++beg;
-		}
-	}
-	// insertion sort on the original container
-	lin_sort(begin, end);
-}
+// kernels for sorting inside each bucket, called on [begin, end) of one bucket
+struct Bucket_ins {		// linear insertion sort, for buckets of a few elements
+	template <typename Iter>
+	void operator()(Iter begin, Iter end) const { lin_sort(begin, end); }
+};
+struct Bucket_pdq {		// pattern-defeating quicksort, for buckets of unknown size
+	template <typename Iter>
+	void operator()(Iter begin, Iter end) const { pdq_sort(begin, end); }
+};
+struct Bucket_rdx {		// radix sort, for integral keys
+	template <typename Iter>
+	void operator()(Iter begin, Iter end) const { rdx_sort(begin, end); }
+};
 
+// linear map from [min, max] onto num_buckets buckets, for numbers spread close to uniformly
 struct Number_bucket_hash {
 	size_t num_buckets;
-	double proportion_of_max;
+	double min_val;
+	double proportion;	// 0 when every value is the same
 
 	Number_bucket_hash() = default;
 	template <typename Iter>
-	Number_bucket_hash(Iter begin, Iter end, size_t n) : num_buckets{n}, 
-		proportion_of_max{(num_buckets-1) / (double)*std::max_element(begin, end)} {}
+	Number_bucket_hash(Iter begin, Iter end, size_t n) : num_buckets{n}, min_val{}, proportion{} {
+		if (begin == end) return;
+		auto mm = Reduce_impl::min_max(begin, end);
+		min_val = mm.first;
+		if (mm.second != mm.first) proportion = (num_buckets - 1) / ((double)mm.second - min_val);
+	}
 
 	size_t size() const {
 		return num_buckets;
 	}
 	template <typename T>
 	size_t operator()(const T& val) const {
-		return (size_t) (val * proportion_of_max);
+		return std::min((size_t) ((val - min_val) * proportion), num_buckets - 1);
 	}
 };
 
+// buckets too big for the kernel get bucket sorted again over their own range, at most depth levels deep
+template <typename Kernel = Bucket_ins>
+struct Bucket_recursive {
+	size_t buckets;
+	size_t cutoff;	// # elements a kernel sorts directly
+	size_t depth;
+	Kernel kernel;
+	Bucket_recursive(size_t b = 256, size_t c = 32, size_t d = 4, Kernel k = Kernel()) :
+		buckets{b}, cutoff{c}, depth{d}, kernel(k) {}
+
+	template <typename Iter>
+	void operator()(Iter begin, Iter end) const;
+};
+
+namespace Bucket_impl {
+
+// bucket b is [begin + offsets[b], begin + offsets[b+1]), sorted in place by kernel
+// with threads, buckets are dealt out in contiguous groups of about equal # elements
+template <typename Iter, typename Kernel>
+void sort_buckets(Iter begin, const std::vector<size_t>& offsets, Kernel& kernel, unsigned threads) {
+	const size_t k {offsets.size() - 1};
+	if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+	if (threads < 2) {
+		for (size_t b = 0; b < k; ++b)
+			if (offsets[b+1] - offsets[b] > 1) kernel(begin + offsets[b], begin + offsets[b+1]);
+		return;
+	}
+	const size_t n {offsets[k]};
+	std::vector<std::thread> workers;
+	size_t first {0};
+	for (unsigned t = 1; t <= threads && first < k; ++t) {
+		// last bucket of this group is the one holding element n * t / threads
+		size_t last {static_cast<size_t>(std::upper_bound(offsets.begin() + first, offsets.end(), n * t / threads) - offsets.begin()) - 1};
+		last = std::max(last, first + 1);
+		if (t == threads) last = k;
+		workers.emplace_back([&, first, last]() {
+			for (size_t b = first; b < last; ++b)
+				if (offsets[b+1] - offsets[b] > 1) kernel(begin + offsets[b], begin + offsets[b+1]);
+		});
+		first = last;
+	}
+	for (auto& w : workers) w.join();
+}
+
+// count bucket sizes, turn them into start offsets, then scatter through one buffer
+// returns the offsets with the end of the last bucket appended
+template <typename Iter, typename Hash>
+std::vector<size_t> scatter(Iter begin, Iter end, Hash& hash) {
+	using T = Iter_value<Iter>;
+	std::vector<size_t> offsets(hash.size() + 1);
+	for (auto cur = begin; cur != end; ++cur) ++offsets[hash(*cur) + 1];
+	for (size_t b = 1; b < offsets.size(); ++b) offsets[b] += offsets[b-1];
+
+	std::vector<T> buf(std::make_move_iterator(begin), std::make_move_iterator(end));
+	std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+	for (auto& v : buf) begin[next[hash(v)]++] = std::move(v);
+	return offsets;
+}
+
+}	// end namespace Bucket_impl
+
+// bucket sort in O(n) for evenly spread keys, each bucket then sorted by kernel (pdq_sort by default)
+// hash must have size_t size() = #buckets; size_t operator(const T&) = bucket for object,
+// and buckets have to be in key order (everything in bucket b is less than anything in b+1)
+// buckets are counted first and scattered into place, so there's one buffer instead of one vector per bucket
+// threads = 0 sorts buckets on all hardware threads
+template <typename Iter, typename Hash, typename Kernel>
+void bucket_sort(Iter begin, const Iter end, Hash&& hash, Kernel kernel, unsigned threads = 1) {
+	if (end - begin < 2) return;
+	const std::vector<size_t> offsets {Bucket_impl::scatter(begin, end, hash)};
+	Bucket_impl::sort_buckets(begin, offsets, kernel, threads);
+}
+template <typename Iter, typename Hash>
+void bucket_sort(Iter begin, const Iter end, Hash&& hash) { bucket_sort(begin, end, hash, Bucket_pdq()); }
+
+template <typename Kernel>
+template <typename Iter>
+void Bucket_recursive<Kernel>::operator()(Iter begin, Iter end) const {
+	if ((size_t)(end - begin) <= cutoff || depth == 0) return kernel(begin, end);
+	Number_bucket_hash hash {begin, end, buckets};
+	if (hash.proportion == 0) return;	// all equal
+	bucket_sort(begin, end, hash, Bucket_recursive{buckets, cutoff, depth - 1, kernel});
+}
+
+// insertion sort is O(nk) where k is supposed to be small after bucketing
+// sorting after putting back into container allows better locality, but requires comparison
+template <typename Iter, typename Hash>
+void bucket_ins_sort(Iter begin, const Iter end, Hash&& hash) {
+	if (end - begin < 2) return;
+	Bucket_impl::scatter(begin, end, hash);
+	// insertion sort on the original container
+	lin_sort(begin, end);
+}
+
 
 }	// end namespace sal
\ No newline at end of file
@@ -0,0 +1,242 @@
+#pragma once
+#include <algorithm>	// min, max
+#include <atomic>
+#include <cstdint>		// uint64_t
+#include <cstdio>		// FILE, fopen, fread, fwrite, tmpfile
+#include <functional>	// less
+#include <random>		// random_device
+#include <stdexcept>	// runtime_error
+#include <string>
+#include <type_traits>	// is_trivially_copyable
+#include <utility>		// swap
+#include <vector>
+#include "timsort.h"
+#include "multiway_merge.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <stdlib.h>		// mkstemp
+#include <sys/types.h>	// off_t
+#include <unistd.h>		// close
+#define SAL_POSIX_FILES
+#endif
+
+namespace sal {
+
+// external merge sort for binary files of fixed size records, for data that doesn't fit in memory
+// 1. read memory-sized chunks, sort each with Timsort and spill it to a temporary run file
+// 2. merge up to fan_in runs at a time with a loser tree until one run is left
+// every read and write goes through large sequential buffers carved out of the memory budget
+struct Ext_sort_config {
+    size_t memory;			// bytes used for run generation and merge buffers
+    size_t fan_in;			// most runs merged at once, more runs mean more passes
+    std::string temp_dir;	// where runs are spilled, empty uses the system's tmpfile()
+    Ext_sort_config(size_t mem = size_t{1} << 28, size_t fan = 64, const std::string& dir = "") :
+        memory{mem}, fan_in{fan}, temp_dir{dir} {}
+};
+
+struct Ext_sort_stats {
+    uint64_t bytes_read {0};
+    uint64_t bytes_written {0};
+    size_t runs {0};		// sorted runs made by run generation
+    size_t passes {0};		// passes over the data, run generation included
+};
+
+namespace Ext_impl {
+
+// owns a file, removes it on destruction if it's a named temporary
+class File {
+    FILE* f;
+    std::string path;	// only kept for temporaries
+public:
+    File(FILE* file, const std::string& p, bool temporary = false) : f{file}, path{temporary ? p : ""} {
+        if (!f) throw std::runtime_error("ext_sort: can't open " + p);
+        std::setvbuf(f, nullptr, _IONBF, 0);	// buffering is done by the readers and writers
+    }
+    File(File&& o) : f{o.f}, path{std::move(o.path)} { o.f = nullptr; o.path.clear(); }
+    File& operator=(File&& o) { std::swap(f, o.f); std::swap(path, o.path); return *this; }
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+    ~File() {
+        if (f) std::fclose(f);
+        if (!path.empty()) std::remove(path.c_str());
+    }
+    FILE* get() const { return f; }
+    // closes it now, for files written to: a failed close means data was lost
+    void close() {
+        FILE* file {f};
+        f = nullptr;
+        if (std::fclose(file) != 0) throw std::runtime_error("ext_sort: write failed on close");
+    }
+};
+
+// size in bytes of a file opened for reading, -1 if it has none (ex. a pipe)
+// 64 bit offsets where long is 32 bits (Windows, wasm32), since the files this is for pass 2 GB
+// (32 bit glibc builds need _FILE_OFFSET_BITS=64 for a 64 bit off_t)
+inline long long file_size(FILE* f) {
+#if defined(_MSC_VER)
+    return _fseeki64(f, 0, SEEK_END) == 0 ? _ftelli64(f) : -1;
+#elif defined(SAL_POSIX_FILES)
+    return ::fseeko(f, 0, SEEK_END) == 0 ? static_cast<long long>(::ftello(f)) : -1;
+#else
+    return std::fseek(f, 0, SEEK_END) == 0 ? std::ftell(f) : -1;
+#endif
+}
+
+// a new run file that no other sort sharing dir, in this process or another, can be handed:
+// mkstemp where there is one, else exclusive creation of a per process name, retried on collision
+inline File temp_file(const std::string& dir) {
+    if (dir.empty()) return File{std::tmpfile(), "temporary file"};
+#if defined(SAL_POSIX_FILES)
+    std::string path {dir + "/sal_run_XXXXXX"};
+    const int fd {::mkstemp(&path[0])};
+    if (fd < 0) throw std::runtime_error("ext_sort: can't create a run file in " + dir);
+    FILE* f {::fdopen(fd, "w+b")};
+    if (!f) {
+        ::close(fd);
+        std::remove(path.c_str());
+    }
+    return File{f, path, true};
+#else
+    static std::atomic<size_t> counter {0};
+    static const unsigned tag {std::random_device{}()};
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        std::string path {dir + "/sal_run_" + std::to_string(tag) + '_' + std::to_string(counter++) + ".tmp"};
+        if (FILE* f = std::fopen(path.c_str(), "w+bx")) return File{f, path, true};
+    }
+    throw std::runtime_error("ext_sort: can't create a run file in " + dir);
+#endif
+}
+
+template <typename T>
+class Reader {
+    FILE* f;
+    std::vector<T> buf;
+    size_t pos, len;
+    uint64_t& bytes_read;
+public:
+    Reader(FILE* file, size_t buf_records, uint64_t& counter) :
+        f{file}, buf(std::max<size_t>(buf_records, 1)), pos{0}, len{0}, bytes_read(counter) {}
+    bool empty() const { return pos == len; }
+    const T& front() const { return buf[pos]; }
+    void pop() { if (++pos == len) refill(); }
+    // fills buf as far as possible, returns # records read
+    size_t refill() {
+        len = std::fread(buf.data(), sizeof(T), buf.size(), f);
+        if (std::ferror(f)) throw std::runtime_error("ext_sort: read failed");
+        bytes_read += len * sizeof(T);
+        pos = 0;
+        return len;
+    }
+    T* data() { return buf.data(); }
+};
+
+template <typename T>
+class Writer {
+    FILE* f;
+    std::vector<T> buf;
+    uint64_t& bytes_written;
+public:
+    Writer(FILE* file, size_t buf_records, uint64_t& counter) : f{file}, bytes_written(counter) {
+        buf.reserve(std::max<size_t>(buf_records, 1));
+    }
+    void push(const T& v) {
+        buf.push_back(v);
+        if (buf.size() == buf.capacity()) flush();
+    }
+    void write(const T* data, size_t n) {
+        if (std::fwrite(data, sizeof(T), n, f) != n) throw std::runtime_error("ext_sort: write failed");
+        bytes_written += n * sizeof(T);
+    }
+    // has to be called once done, records still buffered when it goes are dropped
+    void flush() {
+        write(buf.data(), buf.size());
+        buf.clear();
+    }
+};
+
+// merge whole files in runs into out, each with its share of the memory budget
+// readers are loser tree sources, a run's buffer refills as its front is popped
+template <typename T, typename Cmp>
+void merge_runs(std::vector<File>& runs, size_t first, size_t last, FILE* out, size_t memory, Cmp cmp,
+                Ext_sort_stats& stats) {
+    const size_t buf_records {memory / ((last - first + 1) * sizeof(T))};
+    std::vector<Reader<T>> readers;
+    readers.reserve(last - first);
+    for (size_t r = first; r < last; ++r) {
+        std::rewind(runs[r].get());
+        readers.emplace_back(runs[r].get(), buf_records, stats.bytes_read);
+        readers.back().refill();
+    }
+    Writer<T> writer {out, buf_records, stats.bytes_written};
+    for (Loser_tree<Reader<T>, Cmp> tree {readers, cmp}; !tree.empty(); tree.pop())
+        writer.push(tree.top());
+    writer.flush();
+}
+
+}	// end namespace Ext_impl
+
+// sorts the records of type T in in_path into out_path
+// T has to be trivially copyable since records are read and written as raw bytes
+template <typename T, typename Cmp>
+Ext_sort_stats ext_sort(const std::string& in_path, const std::string& out_path, Cmp cmp,
+                        const Ext_sort_config& config = Ext_sort_config{}) {
+    static_assert(std::is_trivially_copyable<T>::value, "ext_sort records are copied as raw bytes");
+    using namespace Ext_impl;
+    Ext_sort_stats stats;
+    const size_t fan_in {std::max<size_t>(config.fan_in, 2)};
+
+    File in {std::fopen(in_path.c_str(), "rb"), in_path};
+    const long long bytes {file_size(in.get())};
+    if (bytes < 0) throw std::runtime_error("ext_sort: can't find the size of " + in_path);
+    const uint64_t records = static_cast<uint64_t>(bytes) / sizeof(T);
+    if (static_cast<uint64_t>(bytes) % sizeof(T)) throw std::runtime_error("ext_sort: file size isn't a multiple of the record size");
+    std::rewind(in.get());
+
+    // runs get 2/3 of the budget, Timsort's merge buffer can take up to half a run
+    std::vector<File> runs;
+    stats.passes = 1;
+    {
+        const size_t run_records = std::min<uint64_t>(records, config.memory / sizeof(T) * 2 / 3);
+        Reader<T> chunk {in.get(), run_records, stats.bytes_read};
+        Timsort<T*, Cmp> sorter {cmp};
+        // fits in memory, sort straight into the output
+        if (records <= run_records) {
+            size_t n {chunk.refill()};
+            sorter(chunk.data(), chunk.data() + n);
+            File out {std::fopen(out_path.c_str(), "wb"), out_path};
+            Writer<T> {out.get(), 0, stats.bytes_written}.write(chunk.data(), n);
+            out.close();
+            stats.runs = n ? 1 : 0;
+            return stats;
+        }
+        for (size_t n = chunk.refill(); n != 0; n = chunk.refill()) {
+            sorter(chunk.data(), chunk.data() + n);
+            runs.push_back(temp_file(config.temp_dir));
+            Writer<T> {runs.back().get(), 0, stats.bytes_written}.write(chunk.data(), n);
+        }
+        stats.runs = runs.size();
+    }	// run memory given back before merging
+
+    // intermediate passes until the last merge can take all runs at once
+    while (runs.size() > fan_in) {
+        std::vector<File> merged;
+        for (size_t r = 0; r < runs.size(); r += fan_in) {
+            merged.push_back(temp_file(config.temp_dir));
+            merge_runs<T>(runs, r, std::min(r + fan_in, runs.size()), merged.back().get(), config.memory, cmp, stats);
+        }
+        runs.swap(merged);
+        ++stats.passes;
+    }
+
+    File out {std::fopen(out_path.c_str(), "wb"), out_path};
+    merge_runs<T>(runs, 0, runs.size(), out.get(), config.memory, cmp, stats);
+    out.close();
+    ++stats.passes;
+    return stats;
+}
+template <typename T>
+Ext_sort_stats ext_sort(const std::string& in_path, const std::string& out_path,
+                        const Ext_sort_config& config = Ext_sort_config{}) {
+    return ext_sort<T>(in_path, out_path, std::less<T>(), config);
+}
+
+}
\ No newline at end of file
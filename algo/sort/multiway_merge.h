@@ -0,0 +1,161 @@
+#pragma once
+#include <algorithm>	// lower_bound, upper_bound, max
+#include <functional>	// less
+#include <iterator>		// iterator_traits
+#include <thread>
+#include <utility>		// pair, swap, declval
+#include <vector>
+#include "../macros.h"	// Iter_value
+
+namespace sal {
+
+// k-way merge with a tournament tree that keeps the loser of each match (loser tree)
+// the overall winner sits at node 0; when it advances, only the matches on its path to the root
+// are replayed, so each output element costs lgk comparisons (a heap needs about 2lgk)
+// a Source has empty(), front() and pop(); exhausted sources lose every match, so no sentinel
+// values are needed; ties go to the lower source index, making the merge stable
+template <typename Source, typename Cmp>
+class Loser_tree {
+    std::vector<Source>& sources;
+    std::vector<size_t> tree;	// tree[0] is the winner, tree[1..k) losers of internal matches
+    Cmp cmp;
+
+    bool beats(size_t a, size_t b) const {
+        if (sources[a].empty()) return false;
+        if (sources[b].empty()) return true;
+        if (cmp(sources[b].front(), sources[a].front())) return false;
+        if (cmp(sources[a].front(), sources[b].front())) return true;
+        return a < b;
+    }
+public:
+    Loser_tree(std::vector<Source>& s, Cmp c) : sources(s), tree(std::max<size_t>(s.size(), 1)), cmp(c) {
+        // leaf i is node k + i, play every match bottom up
+        const size_t k {sources.size()};
+        std::vector<size_t> winner(2 * k);
+        for (size_t i = 0; i < k; ++i) winner[k + i] = i;
+        for (size_t n = k - 1; n > 0 && k > 1; --n) {
+            size_t a {winner[2*n]}, b {winner[2*n + 1]};
+            if (!beats(a, b)) std::swap(a, b);
+            winner[n] = a;
+            tree[n] = b;
+        }
+        tree[0] = k > 1 ? winner[1] : 0;
+    }
+    bool empty() const { return sources.empty() || sources[tree[0]].empty(); }
+    size_t winner() const { return tree[0]; }
+    auto top() const -> decltype(std::declval<const Source&>().front()) { return sources[tree[0]].front(); }
+    // advance the winning source and replay its path
+    void pop() {
+        size_t w {tree[0]};
+        sources[w].pop();
+        for (size_t n = (sources.size() + w) / 2; n > 0; n /= 2)
+            if (beats(tree[n], w)) std::swap(tree[n], w);
+        tree[0] = w;
+    }
+};
+
+// sorted range [cur, end) as a Source
+// front() is whatever the iterator yields, so move iterators move the merged elements out
+template <typename Iter>
+struct Range_source {
+    Iter cur, end;
+    Range_source(Iter b, Iter e) : cur{b}, end{e} {}
+    bool empty() const { return cur == end; }
+    typename std::iterator_traits<Iter>::reference front() const { return *cur; }
+    void pop() { ++cur; }
+};
+
+// merge sorted ranges into out, stable across ranges (earlier ranges first on ties)
+template <typename Iter, typename Out, typename Cmp>
+Out multiway_merge(const std::vector<std::pair<Iter, Iter>>& ranges, Out out, Cmp cmp) {
+    std::vector<Range_source<Iter>> sources;
+    size_t live {0};
+    for (auto& r : ranges) {
+        sources.emplace_back(r.first, r.second);
+        if (r.first != r.second) ++live;
+    }
+    Loser_tree<Range_source<Iter>, Cmp> tree {sources, cmp};
+    // once one range is left the rest of it can be copied without comparing
+    while (live > 1) {
+        *out++ = tree.top();
+        size_t w {tree.winner()};
+        tree.pop();
+        if (sources[w].empty()) --live;
+    }
+    if (live) {
+        Range_source<Iter>& last = sources[tree.winner()];
+        out = std::copy(last.cur, last.end, out);
+    }
+    return out;
+}
+template <typename Iter, typename Out>
+Out multiway_merge(const std::vector<std::pair<Iter, Iter>>& ranges, Out out) {
+    return multiway_merge(ranges, out, std::less<Iter_value<Iter>>());
+}
+
+// co-ranking: how many elements of each range are among the rank smallest of the merged output
+// elements are ordered by (value, range index, position) which is exactly stable merge order
+// each range keeps a window [lo, hi) its split must lie in; a probe at the middle of the widest window
+// finds the probe's merged rank with binary searches and shrinks every window, O(k^2 lg^2 n)
+template <typename Iter, typename Cmp>
+std::vector<size_t> co_rank(const std::vector<std::pair<Iter, Iter>>& ranges, size_t rank, Cmp cmp) {
+    const size_t k {ranges.size()};
+    std::vector<size_t> lo(k, 0), hi(k), below(k);
+    for (size_t j = 0; j < k; ++j) hi[j] = ranges[j].second - ranges[j].first;
+
+    while (true) {
+        size_t i {k};
+        for (size_t j = 0; j < k; ++j)
+            if (hi[j] > lo[j] && (i == k || hi[j] - lo[j] > hi[i] - lo[i])) i = j;
+        if (i == k) return lo;
+
+        const size_t m {lo[i] + (hi[i] - lo[i]) / 2};
+        const auto& probe = ranges[i].first[m];
+        // # elements ordered before the probe in each range
+        size_t probe_rank {0};
+        for (size_t j = 0; j < k; ++j) {
+            if (j < i) below[j] = std::upper_bound(ranges[j].first, ranges[j].second, probe, cmp) - ranges[j].first;
+            else if (j > i) below[j] = std::lower_bound(ranges[j].first, ranges[j].second, probe, cmp) - ranges[j].first;
+            else below[j] = m;
+            probe_rank += below[j];
+        }
+        if (probe_rank < rank) {	// probe is in the output's first rank elements
+            for (size_t j = 0; j < k; ++j) lo[j] = std::max(lo[j], below[j]);
+            lo[i] = m + 1;
+        }
+        else {
+            for (size_t j = 0; j < k; ++j) hi[j] = std::min(hi[j], below[j]);
+            hi[i] = m;
+        }
+    }
+}
+
+// parallel multiway merge, output split evenly between threads by co-ranking so each thread
+// merges its own slice of every range into its own slice of out; threads = 0 uses all hardware threads
+template <typename Iter, typename Out, typename Cmp>
+Out par_multiway_merge(const std::vector<std::pair<Iter, Iter>>& ranges, Out out, Cmp cmp, unsigned threads = 0) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t total {0};
+    for (auto& r : ranges) total += r.second - r.first;
+    if (threads < 2) return multiway_merge(ranges, out, cmp);
+
+    std::vector<std::vector<size_t>> splits;
+    for (unsigned t = 0; t <= threads; ++t) splits.push_back(co_rank(ranges, total * t / threads, cmp));
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t)
+        workers.emplace_back([&, t]() {
+            std::vector<std::pair<Iter, Iter>> slices;
+            for (size_t j = 0; j < ranges.size(); ++j)
+                slices.emplace_back(ranges[j].first + splits[t][j], ranges[j].first + splits[t+1][j]);
+            multiway_merge(slices, out + total * t / threads, cmp);
+        });
+    for (auto& w : workers) w.join();
+    return out + total;
+}
+template <typename Iter, typename Out>
+Out par_multiway_merge(const std::vector<std::pair<Iter, Iter>>& ranges, Out out) {
+    return par_multiway_merge(ranges, out, std::less<Iter_value<Iter>>());
+}
+
+}
\ No newline at end of file
@@ -1,21 +1,118 @@
 #pragma once
+#include <algorithm>	// iter_swap, min
+#include <iterator>		// iterator_traits
+#include <type_traits>	// integral_constant
+#include <vector>
+#include "../macros.h"	// Iter_value
+#include "simd_partition.h"
 
 namespace sal {
 
+namespace Partition_impl {
+
+constexpr long block_size {64};	// # elements scanned per side before swapping
+
+// scalar partition, left side satisfies predicate; finishes off what the block partition leaves
+template <typename Iter, typename Unary_pred>
+Iter hoare(Iter begin, Iter end, Unary_pred p) {
+    // cannot know whether one pass will be enough unlike the standard < partition
+    while (true) {
+        // continuous left side that satisfies the predicate
+        while ((begin != end) && p(*begin)) ++begin;
+        if (begin == end--) break;
+        // continuous right side that satisfies the predicate
+        while ((begin != end) && !p(*end)) --end;
+        if (begin == end) break;
+        std::iter_swap(begin++, end);
+    }
+    return begin;
+}
+
+// block partition from Edelkamp and Weiss' BlockQuicksort
+// scan a block from each side, recording offsets of misplaced elements without branching on them
+// (the offset is always written, the count only advances if misplaced), then swap the pairs
+template <typename Iter, typename Unary_pred>
+Iter block_partition(Iter begin, Iter end, Unary_pred p) {
+    unsigned char offsets_l[block_size];
+    unsigned char offsets_r[block_size];
+    // misplaced elements are at base_l + offsets_l[start_l..start_l+num_l), base_r - offsets_r[..]
+    Iter base_l {begin}, base_r {end};
+    long num_l {0}, num_r {0}, start_l {0}, start_r {0};
+
+    // [begin, base_l) satisfies p, [base_r, end) doesn't, [begin, end) is the unscanned middle
+    while (end - begin > 2 * block_size) {
+        if (num_l == 0) {
+            start_l = 0;
+            base_l = begin;
+            for (long i = 0; i < block_size; ++i) {
+                offsets_l[num_l] = i;
+                num_l += !p(begin[i]);
+            }
+            begin += block_size;
+        }
+        if (num_r == 0) {
+            start_r = 0;
+            base_r = end;
+            for (long i = 1; i <= block_size; ++i) {
+                offsets_r[num_r] = i;
+                num_r += p(*(end - i));
+            }
+            end -= block_size;
+        }
+        long num {std::min(num_l, num_r)};
+        for (long k = 0; k < num; ++k)
+            std::iter_swap(base_l + offsets_l[start_l + k], base_r - offsets_r[start_r + k]);
+        num_l -= num; num_r -= num;
+        start_l += num; start_r += num;
+    }
+    // at most 4 blocks left unsettled between the bases
+    return hoare(base_l, base_r, p);
+}
+
+template <typename Iter>
+Iter partition_less(Iter begin, Iter end, const Iter_value<Iter>& pivot, std::false_type) {
+    using T = Iter_value<Iter>;
+    return block_partition(begin, end, [&pivot](const T& v){return v < pivot;});
+}
+// contiguous primitive keys with a SIMD kernel for this target
+template <typename Iter>
+Iter partition_less(Iter begin, Iter end, const Iter_value<Iter>& pivot, std::true_type) {
+    if (begin == end) return end;
+    auto first = &*begin;
+    return begin + (simd_partition(first, first + (end - begin), pivot) - first);
+}
+
+template <typename Iter>
+struct Use_simd {
+    using T = Iter_value<Iter>;
+    static constexpr bool value = Simd_less<T>::available &&
+        (std::is_same<Iter, T*>::value || std::is_same<Iter, typename std::vector<T>::iterator>::value);
+};
+
+template <typename Iter, typename Unary_pred>
+Iter partition(Iter begin, Iter end, Unary_pred p, std::random_access_iterator_tag) {
+    return block_partition(begin, end, p);
+}
+template <typename Iter, typename Unary_pred>
+Iter partition(Iter begin, Iter end, Unary_pred p, std::bidirectional_iterator_tag) {
+    return hoare(begin, end, p);
+}
+
+}	// end namespace Partition_impl
+
 // Partition, O(n) core algorithm that's used in many others
+// branchless block partition, or SIMD compress stores for primitive keys in contiguous memory
 template <typename Iter>
 Iter partition(Iter begin, Iter end) {
-    using T = typename Iter::value_type;
+    using T = Iter_value<Iter>;
+    if (begin == end) return end;
     // swap first element with middle, could replace with random
     // put pivot element out of the way at begin (never to be swapped out during partition)
     std::iter_swap(begin, begin+(end-begin)/2);
     T pivot {*begin};
-    // i points to the boundary of the left partition, grown when something less than pivot should be put there
-    auto i = begin;
-    for (auto j = begin + 1; j != end; ++j) {
-        if (*j < pivot)
-            std::iter_swap(++i, j);
-    }
+    // boundary of the elements less than pivot
+    Iter i {Partition_impl::partition_less(begin + 1, end, pivot,
+        std::integral_constant<bool, Partition_impl::Use_simd<Iter>::value>{}) - 1};
     // put pivot element back to the boundary and its correct rank
     std::iter_swap(i, begin);
     return i;
@@ -26,17 +123,7 @@ typename Container::iterator partition(Container& c) { return partition(c.begin(
 // partition on a unary predicate
 template <typename Iter, typename Unary_pred>
 Iter partition(Iter begin, Iter end, Unary_pred p) {
-    // cannot know whether one pass will be enough unlike the standard < partition
-    while (true) {
-        // continuous left side that satisfies the predicate
-        while ((begin != end) && p(*begin)) ++begin;
-        if (begin == end--) break;
-        // continuous right side that satisfies the predicate
-        while ((begin != end) && !p(*end)) --end;
-        if (begin == end) break;
-        std::iter_swap(begin++, end);
-    }
-    return begin;
+    return Partition_impl::partition(begin, end, p, typename std::iterator_traits<Iter>::iterator_category{});
 }
 
 }
\ No newline at end of file
@@ -1,42 +1,127 @@
 #pragma once
-#include <algorithm>	// lower_bound
-#include <stack>
-#include "../search.h"	// bin_search
+#include <algorithm>	// lower_bound, reverse
+#include <iterator>		// reverse_iterator, make_move_iterator
+#include <type_traits>	// integral_constant, is_trivially_copyable
+#include <utility>		// move, pair
+#include <vector>
+#include <functional>	// less
+#include "../macros.h"	// Iter_value
+#include "projection.h"	// proj_cmp
+#include "multiway_merge.h"	// multiway_merge
 
 namespace sal {
 
-// patience sort, theoretically O(nlgn) complexity
-// practically much slower due to memory access and moving piles (VERY SLOW)
-// implementation taken from wikibooks
-template <typename Pile>
-bool pless(const Pile& a, const Pile& b) { return a.top() < b.top(); }
-template <typename Pile>
-bool pmore(const Pile& a, const Pile& b) { return b.top() < a.top(); }
-
-template <typename Iter>
-void pat_sort(Iter begin, Iter end) {
-	using T = typename Iter::value_type;
-	using Pile = typename std::stack<T>;
-	std::vector<Pile> piles;	// maintained in ordered by top pile element
+// patience dealing: each element goes on the leftmost pile whose top isn't less than it,
+// or starts a new pile on the right; pile tops stay sorted left to right and each pile is sorted top down
+// tops are kept in their own contiguous array so the binary search doesn't touch the piles
+template <typename T, typename Cmp>
+class Patience_piles {
+	std::vector<T> tops;
+	Cmp cmp;
+public:
+	explicit Patience_piles(Cmp c) : cmp(c) {}
+	// pile index the element goes on
+	size_t place(const T& v) {
+		auto pile = std::lower_bound(tops.begin(), tops.end(), v, cmp);
+		size_t p = pile - tops.begin();
+		if (pile == tops.end()) tops.push_back(v);
+		else *pile = v;
+		return p;
+	}
+	size_t size() const { return tops.size(); }
+};
 
+namespace Pat_impl {
+// deal [begin, end) onto piles, moving the elements
+// trivially copyable keys are mirrored in the dealer's tops, anything else is searched for through the
+// piles' backs so nothing is copied (and move-only keys work)
+template <typename Iter, typename Cmp>
+void deal(Iter begin, Iter end, std::vector<std::vector<Iter_value<Iter>>>& piles, Cmp cmp, std::true_type) {
+	Patience_piles<Iter_value<Iter>, Cmp> dealer {cmp};
+	for (auto cur = begin; cur != end; ++cur) {
+		size_t p {dealer.place(*cur)};
+		if (p == piles.size()) piles.emplace_back();
+		piles[p].push_back(std::move(*cur));
+	}
+}
+template <typename Iter, typename Cmp>
+void deal(Iter begin, Iter end, std::vector<std::vector<Iter_value<Iter>>>& piles, Cmp cmp, std::false_type) {
+	using Pile = std::vector<Iter_value<Iter>>;
 	for (auto cur = begin; cur != end; ++cur) {
-		Pile new_pile;
-		new_pile.push(*cur);
-		// find which pile to insert in
-		auto ins = std::lower_bound(piles.begin(), piles.end(), new_pile, pless<Pile>);
-		if (ins != piles.end()) ins->push(*cur);	// add to existing pile
-		else piles.push_back(new_pile);	// create new pile
-		
+		auto pile = std::lower_bound(piles.begin(), piles.end(), *cur,
+			[&cmp](const Pile& p, const Iter_value<Iter>& v) { return cmp(p.back(), v); });
+		if (pile == piles.end()) pile = piles.emplace(piles.end());
+		pile->push_back(std::move(*cur));
 	}
-	// sorted array satisfy heap property for min-heap
+}
+}	// end namespace Pat_impl
+
+// patience sort, O(nlgn), close to O(n) on nearly sorted input since few piles form
+// piles are contiguous vectors, merged top down (back to front) with a loser tree, moving the elements back
+template <typename Iter, typename Cmp>
+void pat_sort(Iter begin, Iter end, Cmp cmp) {
+	using T = Iter_value<Iter>;
+	using Pile = std::vector<T>;
+	std::vector<Pile> piles;
+	Pat_impl::deal(begin, end, piles, cmp, std::integral_constant<bool, std::is_trivially_copyable<T>::value>{});
+
+	using Top_down = std::move_iterator<typename Pile::reverse_iterator>;
+	std::vector<std::pair<Top_down, Top_down>> ranges;
+	ranges.reserve(piles.size());
+	for (Pile& pile : piles) ranges.emplace_back(std::make_move_iterator(pile.rbegin()), std::make_move_iterator(pile.rend()));
+	multiway_merge(ranges, begin, cmp);
+}
+template <typename Iter, typename Cmp, typename Proj>
+void pat_sort(Iter begin, Iter end, Cmp cmp, Proj proj) { pat_sort(begin, end, proj_cmp(cmp, proj)); }
+template <typename Iter>
+void pat_sort(Iter begin, Iter end) { pat_sort(begin, end, std::less<Iter_value<Iter>>()); }
+
+
+// longest increasing subsequence (strictly increasing under cmp) from the same dealing, O(nlgn)
+// the number of piles is its length; each element remembers the top of the pile to its left
+// when it was placed, and following those links back from the last pile recovers one subsequence
+template <typename Iter, typename Cmp>
+size_t lis_len(Iter begin, Iter end, Cmp cmp) {
+	Patience_piles<Iter_value<Iter>, Cmp> dealer {cmp};
+	for (auto cur = begin; cur != end; ++cur) dealer.place(*cur);
+	return dealer.size();
+}
+template <typename Iter>
+size_t lis_len(Iter begin, Iter end) { return lis_len(begin, end, std::less<Iter_value<Iter>>()); }
+
+template <typename Iter, typename Cmp>
+std::vector<Iter_value<Iter>> lis(Iter begin, Iter end, Cmp cmp) {
+	constexpr size_t none {static_cast<size_t>(-1)};
+	Patience_piles<Iter_value<Iter>, Cmp> dealer {cmp};
+	std::vector<Iter> elems;
+	std::vector<size_t> prev;	// element index below in the subsequence
+	std::vector<size_t> top;	// element index on top of each pile
+
 	for (auto cur = begin; cur != end; ++cur) {
-		// greatest valued pile is moved to back while being a heap
-		std::pop_heap(piles.begin(), piles.end(), pmore<Pile>);
-		*cur = piles.back().top();
-		piles.back().pop();
-		if (piles.back().empty()) piles.pop_back();	// empty pile
-		// maintain heap
-		else std::push_heap(piles.begin(), piles.end(), pmore<Pile>);
+		size_t p {dealer.place(*cur)};
+		prev.push_back(p ? top[p-1] : none);
+		if (p == top.size()) top.push_back(elems.size());
+		else top[p] = elems.size();
+		elems.push_back(cur);
 	}
+
+	std::vector<Iter_value<Iter>> seq;
+	if (top.empty()) return seq;
+	for (size_t e = top.back(); e != none; e = prev[e]) seq.push_back(*elems[e]);
+	std::reverse(seq.begin(), seq.end());
+	return seq;
 }
+template <typename Iter>
+std::vector<Iter_value<Iter>> lis(Iter begin, Iter end) { return lis(begin, end, std::less<Iter_value<Iter>>()); }
+
+// longest decreasing subsequence is increasing under the flipped comparison
+template <typename Iter, typename Cmp>
+std::vector<Iter_value<Iter>> lds(Iter begin, Iter end, Cmp cmp) {
+	return lis(begin, end, [&cmp](const Iter_value<Iter>& a, const Iter_value<Iter>& b) { return cmp(b, a); });
+}
+template <typename Iter>
+std::vector<Iter_value<Iter>> lds(Iter begin, Iter end) { return lds(begin, end, std::less<Iter_value<Iter>>()); }
+template <typename Iter>
+size_t lds_len(Iter begin, Iter end) { return lis_len(begin, end, std::greater<Iter_value<Iter>>()); }
+
 }
\ No newline at end of file
@@ -0,0 +1,367 @@
+#pragma once
+#include <algorithm>	// iter_swap, make_heap, sort_heap
+#include <cstdint>		// uintptr_t
+#include <functional>	// less
+#include <type_traits>	// integral_constant, is_arithmetic
+#include <utility>		// pair
+#include "../macros.h"	// Iter_value, Iter_diff
+#include "projection.h"	// Cheap_cmp, proj_cmp
+#include "sorting_network.h"	// small_sort
+
+namespace sal {
+
+// pattern-defeating quicksort, hybrid of quick sort, insertion sort and heap sort
+// (sorting networks instead of insertion sort for primitive keys under cheap comparisons)
+// O(nlgn) worst case, O(n) on sorted, reverse sorted and all equal sequences
+// adapted from Orson Peters' pdqsort, block partitioning from Edelkamp and Weiss' BlockQuicksort
+namespace Pdq_impl {
+
+constexpr long insertion_threshold {24};	// below this insertion sort wins
+constexpr long ninther_threshold {128};		// above this pivot is median of medians of 3 (ninther)
+constexpr long partial_ins_limit {8};		// max elements moved before giving up on nearly sorted
+constexpr long block_size {64};				// # offsets buffered per side in block partition
+constexpr long cacheline {64};
+
+inline int log2(long n) {
+    int log {0};
+    while (n >>= 1) ++log;
+    return log;
+}
+
+// insertion sort on [begin, end)
+template <typename Iter, typename Cmp>
+void insertion_sort(Iter begin, Iter end, Cmp cmp) {
+    if (begin == end) return;
+    for (Iter cur = begin + 1; cur != end; ++cur) {
+        Iter sift = cur;
+        Iter sift_1 = cur - 1;
+        if (cmp(*sift, *sift_1)) {
+            Iter_value<Iter> key = std::move(*sift);
+            do { *sift-- = std::move(*sift_1); } while (sift != begin && cmp(key, *--sift_1));
+            *sift = std::move(key);
+        }
+    }
+}
+// assumes *(begin - 1) is not greater than anything in [begin, end), so needs no bounds check
+template <typename Iter, typename Cmp>
+void unguarded_insertion_sort(Iter begin, Iter end, Cmp cmp) {
+    if (begin == end) return;
+    for (Iter cur = begin + 1; cur != end; ++cur) {
+        Iter sift = cur;
+        Iter sift_1 = cur - 1;
+        if (cmp(*sift, *sift_1)) {
+            Iter_value<Iter> key = std::move(*sift);
+            do { *sift-- = std::move(*sift_1); } while (cmp(key, *--sift_1));
+            *sift = std::move(key);
+        }
+    }
+}
+// insertion sort that gives up after moving partial_ins_limit elements, true if it finished
+template <typename Iter, typename Cmp>
+bool partial_insertion_sort(Iter begin, Iter end, Cmp cmp) {
+    if (begin == end) return true;
+    long moved {0};
+    for (Iter cur = begin + 1; cur != end; ++cur) {
+        Iter sift = cur;
+        Iter sift_1 = cur - 1;
+        if (cmp(*sift, *sift_1)) {
+            Iter_value<Iter> key = std::move(*sift);
+            do { *sift-- = std::move(*sift_1); } while (sift != begin && cmp(key, *--sift_1));
+            *sift = std::move(key);
+            moved += cur - sift;
+        }
+        if (moved > partial_ins_limit) return false;
+    }
+    return true;
+}
+
+template <typename Iter, typename Cmp>
+void sort2(Iter a, Iter b, Cmp cmp) { if (cmp(*b, *a)) std::iter_swap(a, b); }
+template <typename Iter, typename Cmp>
+void sort3(Iter a, Iter b, Iter c, Cmp cmp) { sort2(a, b, cmp); sort2(b, c, cmp); sort2(a, b, cmp); }
+
+template <typename T>
+T* align_cacheline(T* p) {
+    std::uintptr_t ip {reinterpret_cast<std::uintptr_t>(p)};
+    ip = (ip + cacheline - 1) & -cacheline;
+    return reinterpret_cast<T*>(ip);
+}
+
+// swap the num misplaced pairs recorded as offsets from first and last
+// a cyclic rotation needs fewer moves than swaps, but swaps are needed on equal counts
+// to keep descending input O(n)
+template <typename Iter>
+void swap_offsets(Iter first, Iter last, const unsigned char* offsets_l, const unsigned char* offsets_r,
+                  size_t num, bool use_swaps) {
+    if (use_swaps) {
+        for (size_t i = 0; i < num; ++i) std::iter_swap(first + offsets_l[i], last - offsets_r[i]);
+    }
+    else if (num > 0) {
+        Iter l {first + offsets_l[0]};
+        Iter r {last - offsets_r[0]};
+        Iter_value<Iter> temp = std::move(*l);
+        *l = std::move(*r);
+        for (size_t i = 1; i < num; ++i) {
+            l = first + offsets_l[i];
+            *r = std::move(*l);
+            r = last - offsets_r[i];
+            *l = std::move(*r);
+        }
+        *r = std::move(temp);
+    }
+}
+
+// partition [begin, end) around pivot *begin, elements equal to pivot go right
+// returns final pivot position and whether the range was already partitioned
+// pivot is at least a median of 3 so neither scan can run off the range
+template <typename Iter, typename Cmp>
+std::pair<Iter, bool> partition_right(Iter begin, Iter end, Cmp cmp) {
+    Iter_value<Iter> pivot = std::move(*begin);
+    Iter first {begin};
+    Iter last {end};
+
+    while (cmp(*++first, pivot));
+    // nothing before first to stop the scan, have to guard it
+    if (first - 1 == begin) while (first < last && !cmp(*--last, pivot));
+    else                    while (!cmp(*--last, pivot));
+
+    bool already_partitioned {first >= last};
+    // previously swapped pairs guard the scans from here on
+    while (first < last) {
+        std::iter_swap(first, last);
+        while (cmp(*++first, pivot));
+        while (!cmp(*--last, pivot));
+    }
+
+    Iter pivot_pos {first - 1};
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return {pivot_pos, already_partitioned};
+}
+
+// same contract as partition_right, but comparisons only fill offset buffers (no branches on the data)
+// misplaced elements found on both sides are then swapped in bulk
+template <typename Iter, typename Cmp>
+std::pair<Iter, bool> partition_right_branchless(Iter begin, Iter end, Cmp cmp) {
+    Iter_value<Iter> pivot = std::move(*begin);
+    Iter first {begin};
+    Iter last {end};
+
+    while (cmp(*++first, pivot));
+    if (first - 1 == begin) while (first < last && !cmp(*--last, pivot));
+    else                    while (!cmp(*--last, pivot));
+
+    bool already_partitioned {first >= last};
+    if (!already_partitioned) {
+        std::iter_swap(first, last);
+        ++first;
+
+        unsigned char offsets_l_storage[block_size + cacheline];
+        unsigned char offsets_r_storage[block_size + cacheline];
+        unsigned char* offsets_l {align_cacheline(offsets_l_storage)};
+        unsigned char* offsets_r {align_cacheline(offsets_r_storage)};
+
+        Iter offsets_l_base {first};
+        Iter offsets_r_base {last};
+        size_t num_l {0}, num_r {0}, start_l {0}, start_r {0};
+
+        while (first < last) {
+            // only refill a side's buffer once it's been used up
+            size_t num_unknown = last - first;
+            size_t left_split  {num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0};
+            size_t right_split {num_r == 0 ? (num_unknown - left_split) : 0};
+
+            // record position then advance count only if misplaced, the store is unconditional
+            if (left_split >= (size_t)block_size) {
+                for (unsigned i = 0; i < block_size;) {
+                    offsets_l[num_l] = i++; num_l += !cmp(*first, pivot); ++first;
+                    offsets_l[num_l] = i++; num_l += !cmp(*first, pivot); ++first;
+                    offsets_l[num_l] = i++; num_l += !cmp(*first, pivot); ++first;
+                    offsets_l[num_l] = i++; num_l += !cmp(*first, pivot); ++first;
+                }
+            }
+            else {
+                for (unsigned i = 0; i < left_split;) {
+                    offsets_l[num_l] = i++; num_l += !cmp(*first, pivot); ++first;
+                }
+            }
+
+            if (right_split >= (size_t)block_size) {
+                for (unsigned i = 0; i < block_size;) {
+                    offsets_r[num_r] = ++i; num_r += cmp(*--last, pivot);
+                    offsets_r[num_r] = ++i; num_r += cmp(*--last, pivot);
+                    offsets_r[num_r] = ++i; num_r += cmp(*--last, pivot);
+                    offsets_r[num_r] = ++i; num_r += cmp(*--last, pivot);
+                }
+            }
+            else {
+                for (unsigned i = 0; i < right_split;) {
+                    offsets_r[num_r] = ++i; num_r += cmp(*--last, pivot);
+                }
+            }
+
+            size_t num {std::min(num_l, num_r)};
+            swap_offsets(offsets_l_base, offsets_r_base, offsets_l + start_l, offsets_r + start_r,
+                         num, num_l == num_r);
+            num_l -= num; num_r -= num;
+            start_l += num; start_r += num;
+
+            if (num_l == 0) {
+                start_l = 0;
+                offsets_l_base = first;
+            }
+            if (num_r == 0) {
+                start_r = 0;
+                offsets_r_base = last;
+            }
+        }
+
+        // one side may still have misplaced elements left over, move them to the boundary
+        if (num_l) {
+            offsets_l += start_l;
+            while (num_l--) std::iter_swap(offsets_l_base + offsets_l[num_l], --last);
+            first = last;
+        }
+        if (num_r) {
+            offsets_r += start_r;
+            while (num_r--) { std::iter_swap(offsets_r_base - offsets_r[num_r], first); ++first; }
+            last = first;
+        }
+    }
+
+    Iter pivot_pos {first - 1};
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return {pivot_pos, already_partitioned};
+}
+
+// partition with elements equal to pivot *begin going left, used when there are many duplicates
+// returns final pivot position
+template <typename Iter, typename Cmp>
+Iter partition_left(Iter begin, Iter end, Cmp cmp) {
+    Iter_value<Iter> pivot = std::move(*begin);
+    Iter first {begin};
+    Iter last {end};
+
+    while (cmp(pivot, *--last));
+    if (last + 1 == end) while (first < last && !cmp(pivot, *++first));
+    else                 while (!cmp(pivot, *++first));
+
+    while (first < last) {
+        std::iter_swap(first, last);
+        while (cmp(pivot, *--last));
+        while (!cmp(pivot, *++first));
+    }
+
+    Iter pivot_pos {last};
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return pivot_pos;
+}
+
+// ranges under insertion_threshold, a sorting network when elements are primitive keys
+template <typename Iter, typename Cmp>
+void small_range(Iter begin, Iter end, Cmp cmp, bool, std::true_type) { small_sort(begin, end, cmp); }
+template <typename Iter, typename Cmp>
+void small_range(Iter begin, Iter end, Cmp cmp, bool leftmost, std::false_type) {
+    if (leftmost) insertion_sort(begin, end, cmp);
+    else unguarded_insertion_sort(begin, end, cmp);
+}
+
+// sorts left partition recursively and loops on the right
+// bad_allowed is how many unbalanced partitions can happen before switching to heap sort
+template <typename Iter, typename Cmp, bool Branchless>
+void pdq_loop(Iter begin, Iter end, Cmp cmp, int bad_allowed, bool leftmost = true) {
+    using D = Iter_diff<Iter>;
+    while (true) {
+        D size {end - begin};
+
+        if (size < insertion_threshold) {
+            small_range(begin, end, cmp, leftmost,
+                std::integral_constant<bool, Branchless && std::is_arithmetic<Iter_value<Iter>>::value>{});
+            return;
+        }
+
+        // pivot as median of 3 or pseudomedian of 9, moved to begin
+        D half {size / 2};
+        if (size > ninther_threshold) {
+            sort3(begin, begin + half, end - 1, cmp);
+            sort3(begin + 1, begin + (half - 1), end - 2, cmp);
+            sort3(begin + 2, begin + (half + 1), end - 3, cmp);
+            sort3(begin + (half - 1), begin + half, begin + (half + 1), cmp);
+            std::iter_swap(begin, begin + half);
+        }
+        else sort3(begin + half, begin, end - 1, cmp);
+
+        // *(begin - 1) is the pivot of a previous partition, nothing here is smaller than it
+        // so pivot equal to it means a run of equal elements; put them all left and skip over them
+        if (!leftmost && !cmp(*(begin - 1), *begin)) {
+            begin = partition_left(begin, end, cmp) + 1;
+            continue;
+        }
+
+        std::pair<Iter, bool> part {Branchless ? partition_right_branchless(begin, end, cmp)
+                                               : partition_right(begin, end, cmp)};
+        Iter pivot_pos {part.first};
+        bool already_partitioned {part.second};
+
+        D l_size {pivot_pos - begin};
+        D r_size {end - (pivot_pos + 1)};
+        bool unbalanced {l_size < size / 8 || r_size < size / 8};
+
+        if (unbalanced) {
+            // too many bad partitions, heap sort guarantees O(nlgn)
+            if (--bad_allowed == 0) {
+                std::make_heap(begin, end, cmp);
+                std::sort_heap(begin, end, cmp);
+                return;
+            }
+            // swap some elements around to break up the pattern that caused the bad pivot
+            if (l_size >= insertion_threshold) {
+                std::iter_swap(begin, begin + l_size / 4);
+                std::iter_swap(pivot_pos - 1, pivot_pos - l_size / 4);
+                if (l_size > ninther_threshold) {
+                    std::iter_swap(begin + 1, begin + (l_size / 4 + 1));
+                    std::iter_swap(begin + 2, begin + (l_size / 4 + 2));
+                    std::iter_swap(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+                    std::iter_swap(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+                }
+            }
+            if (r_size >= insertion_threshold) {
+                std::iter_swap(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+                std::iter_swap(end - 1, end - r_size / 4);
+                if (r_size > ninther_threshold) {
+                    std::iter_swap(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+                    std::iter_swap(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+                    std::iter_swap(end - 2, end - (1 + r_size / 4));
+                    std::iter_swap(end - 3, end - (2 + r_size / 4));
+                }
+            }
+        }
+        // balanced and nothing had to move, likely (nearly) sorted so try finishing with insertion sort
+        else if (already_partitioned && partial_insertion_sort(begin, pivot_pos, cmp)
+                                     && partial_insertion_sort(pivot_pos + 1, end, cmp)) return;
+
+        pdq_loop<Iter, Cmp, Branchless>(begin, pivot_pos, cmp, bad_allowed, leftmost);
+        begin = pivot_pos + 1;
+        leftmost = false;
+    }
+}
+
+}	// end namespace Pdq_impl
+
+template <typename Iter, typename Cmp>
+void pdq_sort(Iter begin, Iter end, Cmp cmp) {
+    if (end - begin < 2) return;
+    // branchless partitioning only pays off when comparisons are cheap and can't be predicted
+    Pdq_impl::pdq_loop<Iter, Cmp, Cheap_cmp<Cmp, Iter_value<Iter>>::value>(
+        begin, end, cmp, Pdq_impl::log2(end - begin));
+}
+template <typename Iter, typename Cmp, typename Proj>
+void pdq_sort(Iter begin, Iter end, Cmp cmp, Proj proj) { pdq_sort(begin, end, proj_cmp(cmp, proj)); }
+template <typename Iter>
+void pdq_sort(Iter begin, Iter end) { pdq_sort(begin, end, std::less<Iter_value<Iter>>()); }
+template <typename Container>
+void pdq_sort(Container& c) { pdq_sort(c.begin(), c.end()); }
+
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include <functional>	// less, greater
+#include <type_traits>	// is_arithmetic, decay
+#include <utility>		// declval
+
+namespace sal {
+
+// comparator on a projection of the elements, ex. sort records by a field or in descending order
+// cmp(proj(a), proj(b)); every sort taking (cmp, proj) wraps them in this, and it can be passed
+// anywhere a comparator goes (proj can be a lambda or std::mem_fn of a member pointer)
+template <typename Cmp, typename Proj>
+struct Proj_cmp {
+    Cmp cmp;
+    Proj proj;
+    template <typename A, typename B>
+    bool operator()(const A& a, const B& b) const { return cmp(proj(a), proj(b)); }
+};
+template <typename Cmp, typename Proj>
+Proj_cmp<Cmp, Proj> proj_cmp(Cmp cmp, Proj proj) { return {cmp, proj}; }
+
+// whether comparisons under Cmp are cheap and unpredictable enough for branchless kernels
+// true for < and > on arithmetic keys, including when reached through a projection
+template <typename Cmp, typename T>
+struct Cheap_cmp {
+    static constexpr bool value = std::is_arithmetic<T>::value &&
+        (std::is_same<Cmp, std::less<T>>::value || std::is_same<Cmp, std::greater<T>>::value);
+};
+template <typename Cmp, typename Proj, typename T>
+struct Cheap_cmp<Proj_cmp<Cmp, Proj>, T> {
+    using Key = typename std::decay<decltype(std::declval<Proj>()(std::declval<const T&>()))>::type;
+    static constexpr bool value = Cheap_cmp<Cmp, Key>::value;
+};
+
+// whether elements that compare equal under Cmp are identical, so a stable sort can use unstable kernels
+// true for < and > directly on integers; not through projections, and not on floats (-0.0 == 0.0)
+template <typename Cmp, typename T>
+struct Ties_indistinct {
+    static constexpr bool value = std::is_integral<T>::value &&
+        (std::is_same<Cmp, std::less<T>>::value || std::is_same<Cmp, std::greater<T>>::value);
+};
+
+}
\ No newline at end of file
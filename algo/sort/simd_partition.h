@@ -0,0 +1,188 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>	// swap
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace sal {
+namespace Partition_impl {
+
+// register-wide partition by < pivot for primitive keys, instruction set picked at compile time
+// (build with -mavx2 or -mavx512f, or -march=native); Simd_less<T>::available is false otherwise
+// each register of keys is compared against the pivot in one instruction and the lanes below it
+// are compressed into the left write cursor, the rest into the right write cursor
+template <typename T>
+struct Simd_less { static constexpr bool available = false; };
+
+inline unsigned popcount(unsigned m) {
+#if defined(__GNUC__)
+    return __builtin_popcount(m);
+#else
+    unsigned n {0};
+    while (m) { m &= m - 1; ++n; }
+    return n;
+#endif
+}
+
+#if defined(__AVX512F__)
+// AVX-512 has compress stores, masks are one bit per lane
+template <>
+struct Simd_less<int32_t> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 16;
+    using Vec = __m512i;
+    static Vec load(const int32_t* p) { return _mm512_loadu_si512(p); }
+    static Vec load_partial(const int32_t* p, unsigned m) { return _mm512_maskz_loadu_epi32(m, p); }
+    static Vec broadcast(int32_t x) { return _mm512_set1_epi32(x); }
+    static unsigned less(Vec v, Vec pivot) { return _mm512_cmplt_epi32_mask(v, pivot); }
+    static void compress_store(int32_t* p, unsigned m, Vec v) { _mm512_mask_compressstoreu_epi32(p, m, v); }
+};
+template <>
+struct Simd_less<int64_t> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 8;
+    using Vec = __m512i;
+    static Vec load(const int64_t* p) { return _mm512_loadu_si512(p); }
+    static Vec load_partial(const int64_t* p, unsigned m) { return _mm512_maskz_loadu_epi64(m, p); }
+    static Vec broadcast(int64_t x) { return _mm512_set1_epi64(x); }
+    static unsigned less(Vec v, Vec pivot) { return _mm512_cmplt_epi64_mask(v, pivot); }
+    static void compress_store(int64_t* p, unsigned m, Vec v) { _mm512_mask_compressstoreu_epi64(p, m, v); }
+};
+template <>
+struct Simd_less<float> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 16;
+    using Vec = __m512;
+    static Vec load(const float* p) { return _mm512_loadu_ps(p); }
+    static Vec load_partial(const float* p, unsigned m) { return _mm512_maskz_loadu_ps(m, p); }
+    static Vec broadcast(float x) { return _mm512_set1_ps(x); }
+    static unsigned less(Vec v, Vec pivot) { return _mm512_cmp_ps_mask(v, pivot, _CMP_LT_OQ); }
+    static void compress_store(float* p, unsigned m, Vec v) { _mm512_mask_compressstoreu_ps(p, m, v); }
+};
+template <>
+struct Simd_less<double> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 8;
+    using Vec = __m512d;
+    static Vec load(const double* p) { return _mm512_loadu_pd(p); }
+    static Vec load_partial(const double* p, unsigned m) { return _mm512_maskz_loadu_pd(m, p); }
+    static Vec broadcast(double x) { return _mm512_set1_pd(x); }
+    static unsigned less(Vec v, Vec pivot) { return _mm512_cmp_pd_mask(v, pivot, _CMP_LT_OQ); }
+    static void compress_store(double* p, unsigned m, Vec v) { _mm512_mask_compressstoreu_pd(p, m, v); }
+};
+
+#elif defined(__AVX2__)
+// AVX2 has no compress store, emulate with a lane permutation looked up by mask then a masked store
+struct Compress_table {
+    alignas(32) int32_t idx[256][8];
+    Compress_table() {
+        for (unsigned m = 0; m < 256; ++m) {
+            unsigned k {0};
+            for (int32_t lane = 0; lane < 8; ++lane)
+                if (m >> lane & 1) idx[m][k++] = lane;
+            for (; k < 8; ++k) idx[m][k] = 0;
+        }
+    }
+};
+inline __m256i compress_perm(unsigned m) {
+    static const Compress_table table;
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(table.idx[m]));
+}
+// lanes 0..n-1 on
+inline __m256i first_lanes(unsigned n) {
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+template <>
+struct Simd_less<int32_t> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 8;
+    using Vec = __m256i;
+    static Vec load(const int32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static Vec load_partial(const int32_t* p, unsigned m) { return _mm256_maskload_epi32(p, first_lanes(popcount(m))); }
+    static Vec broadcast(int32_t x) { return _mm256_set1_epi32(x); }
+    static unsigned less(Vec v, Vec pivot) {
+        return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(pivot, v)));
+    }
+    static void compress_store(int32_t* p, unsigned m, Vec v) {
+        _mm256_maskstore_epi32(p, first_lanes(popcount(m)), _mm256_permutevar8x32_epi32(v, compress_perm(m)));
+    }
+};
+template <>
+struct Simd_less<float> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 8;
+    using Vec = __m256;
+    static Vec load(const float* p) { return _mm256_loadu_ps(p); }
+    static Vec load_partial(const float* p, unsigned m) { return _mm256_maskload_ps(p, first_lanes(popcount(m))); }
+    static Vec broadcast(float x) { return _mm256_set1_ps(x); }
+    static unsigned less(Vec v, Vec pivot) { return _mm256_movemask_ps(_mm256_cmp_ps(v, pivot, _CMP_LT_OQ)); }
+    static void compress_store(float* p, unsigned m, Vec v) {
+        _mm256_maskstore_ps(p, first_lanes(popcount(m)), _mm256_permutevar8x32_ps(v, compress_perm(m)));
+    }
+};
+#endif
+
+// partition [begin, end) so elements < pivot come first, returns the boundary
+// first and last register are held back to open up room, after that each step reads a register
+// from whichever side has less room left, so writes never overtake unread elements
+template <typename T>
+T* simd_partition(T* begin, T* end, T pivot) {
+    using S = Simd_less<T>;
+    constexpr unsigned W {S::lanes};
+    const unsigned all {(1u << W) - 1};
+
+    if (end - begin < 2 * (std::ptrdiff_t)W) {
+        T* i {begin};
+        for (T* j = begin; j != end; ++j)
+            if (*j < pivot) std::swap(*i++, *j);
+        return i;
+    }
+
+    const typename S::Vec pv {S::broadcast(pivot)};
+    T* left_w {begin};
+    T* right_w {end};
+    T* left_r {begin + W};
+    T* right_r {end - W};
+    const typename S::Vec first {S::load(begin)};
+    const typename S::Vec last {S::load(end - W)};
+
+    auto store = [&](typename S::Vec v, unsigned valid) {
+        unsigned below {S::less(v, pv) & valid};
+        unsigned above {~below & valid};
+        S::compress_store(left_w, below, v);
+        left_w += popcount(below);
+        right_w -= popcount(above);
+        S::compress_store(right_w, above, v);
+    };
+
+    // leftover that doesn't fill a register, so the rest of the loop reads whole registers
+    unsigned rem = (right_r - left_r) % W;
+    if (rem) {
+        unsigned valid {(1u << rem) - 1};
+        typename S::Vec v {S::load_partial(left_r, valid)};
+        left_r += rem;
+        store(v, valid);
+    }
+
+    while (left_r != right_r) {
+        typename S::Vec v;
+        if (left_r - left_w <= right_w - right_r) {
+            v = S::load(left_r);
+            left_r += W;
+        }
+        else {
+            right_r -= W;
+            v = S::load(right_r);
+        }
+        store(v, all);
+    }
+
+    store(first, all);
+    store(last, all);
+    return left_w;
+}
+
+}	// end namespace Partition_impl
+}
\ No newline at end of file
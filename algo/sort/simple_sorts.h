@@ -1,50 +1,74 @@
 #pragma once
 #include <algorithm>
+#include <functional>	// less
+#include "../macros.h"	// Iter_value
+#include "projection.h"	// proj_cmp
 
 namespace sal {
 
+// every sort takes an optional comparator, or comparator and projection (compare proj(a) to proj(b))
+// the overloads without one use std::less, which inlines to plain <
+
 // Bubble sort O(n^2) time O(1) space
-template <typename Iter>
-void bub_sort(Iter begin, const Iter end) {
+template <typename Iter, typename Cmp>
+void bub_sort(Iter begin, const Iter end, Cmp cmp) {
+    if (begin == end) return;
     for (; begin != end - 1; ++begin) {
         for (Iter cur = end - 1; cur != begin; --cur)
-            if (*cur < *(cur - 1)) std::swap(*cur, *(cur - 1));
+            if (cmp(*cur, *(cur - 1))) std::swap(*cur, *(cur - 1));
     }
 }
+template <typename Iter, typename Cmp, typename Proj>
+void bub_sort(Iter begin, const Iter end, Cmp cmp, Proj proj) { bub_sort(begin, end, proj_cmp(cmp, proj)); }
+template <typename Iter>
+void bub_sort(Iter begin, const Iter end) { bub_sort(begin, end, std::less<Iter_value<Iter>>()); }
 template <typename Container>
 void bub_sort(Container& c) { bub_sort(c.begin(), c.end()); }
 
 // Linear insert sort O(n^2) time O(1) space
 // Costs only O(nk) time if all elements at most k places away from correct position
-template <typename Iter>
-void lin_sort(const Iter begin, const Iter end, Iter cur) {
+// [begin, cur) is already sorted
+template <typename Iter, typename Cmp>
+void lin_sort(const Iter begin, const Iter end, Iter cur, Cmp cmp) {
     for (; cur != end; ++cur) {
         auto key = std::move(*cur);
-        auto ins = cur - 1;
-        for (; begin <= ins && key < *ins; --ins)
-            *(ins + 1) = std::move(*ins);    // keep shifting to the right until element larger than key found
-        *(ins + 1) = std::move(key);
+        auto ins = cur;
+        for (; ins != begin && cmp(key, *(ins - 1)); --ins)
+            *ins = std::move(*(ins - 1));    // keep shifting to the right until element larger than key found
+        *ins = std::move(key);
     }
 }
 template <typename Iter>
+void lin_sort(const Iter begin, const Iter end, Iter cur) { lin_sort(begin, end, cur, std::less<Iter_value<Iter>>()); }
+template <typename Iter, typename Cmp>
+void lin_sort(const Iter begin, const Iter end, Cmp cmp) { lin_sort(begin, end, begin, cmp); }
+template <typename Iter, typename Cmp, typename Proj>
+void lin_sort(const Iter begin, const Iter end, Cmp cmp, Proj proj) { lin_sort(begin, end, begin, proj_cmp(cmp, proj)); }
+template <typename Iter>
 void lin_sort(const Iter begin, const Iter end) { lin_sort(begin, end, begin); }
 template <typename Container>
 void lin_sort(Container& c) { lin_sort(c.begin(), c.end()); }
 
 // Binary insertion sort O(n^2) time O(1) space, binary search to insert instead of swapping
-template <typename Iter>
-void ins_sort(const Iter begin, const Iter end, Iter cur ) {
+template <typename Iter, typename Cmp>
+void ins_sort(const Iter begin, const Iter end, Iter cur, Cmp cmp) {
     for(; cur < end; ++cur) {
-        typename Iter::value_type pivot = std::move(*cur);
+        Iter_value<Iter> pivot = std::move(*cur);
 
         // upper_bound is binary search for correct insertion position
-        const Iter pos = std::upper_bound(begin, cur, pivot);
+        const Iter pos = std::upper_bound(begin, cur, pivot, cmp);
         for(Iter ins = cur; ins != pos; --ins)
             *ins = std::move(*(ins - 1));
         *pos = std::move(pivot);
     }
 }
 template <typename Iter>
+void ins_sort(const Iter begin, const Iter end, Iter cur) { ins_sort(begin, end, cur, std::less<Iter_value<Iter>>()); }
+template <typename Iter, typename Cmp>
+void ins_sort(const Iter begin, const Iter end, Cmp cmp) { ins_sort(begin, end, begin, cmp); }
+template <typename Iter, typename Cmp, typename Proj>
+void ins_sort(const Iter begin, const Iter end, Cmp cmp, Proj proj) { ins_sort(begin, end, begin, proj_cmp(cmp, proj)); }
+template <typename Iter>
 void ins_sort(const Iter begin, const Iter end) { ins_sort(begin, end, begin); }
 template <typename Container>
 void ins_sort(Container& c) { ins_sort(c.begin(), c.end()); }
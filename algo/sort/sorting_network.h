@@ -0,0 +1,356 @@
+#pragma once
+#include <algorithm>	// iter_swap, copy
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>	// less
+#include <limits>
+#include <new>			// placement new
+#include <type_traits>	// is_arithmetic, is_same, integral_constant, aligned_storage
+#include <utility>		// move
+#include <vector>
+#include "../macros.h"	// Iter_value
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace sal {
+
+// sorting networks, a fixed sequence of compare-exchanges that doesn't depend on the data
+// branchless for arithmetic keys (each compare-exchange becomes a min and a max), so no mispredictions,
+// which makes them the fastest base case for short ranges of primitive keys; not stable
+namespace Network_impl {
+
+constexpr size_t network_max {16};	// largest network generated
+constexpr size_t small_max {2 * network_max};	// small_sort merges two networks up to this
+
+// compare-exchange so *a is not greater than *b
+template <typename Iter, typename Cmp>
+void cswap(Iter a, Iter b, Cmp cmp, std::true_type /*select*/) {
+    using T = Iter_value<Iter>;
+    const bool swap {cmp(*b, *a)};
+    const T lo {swap ? *b : *a};
+    const T hi {swap ? *a : *b};
+    *a = lo;
+    *b = hi;
+}
+template <typename Iter, typename Cmp>
+void cswap(Iter a, Iter b, Cmp cmp, std::false_type) {
+    if (cmp(*b, *a)) std::iter_swap(a, b);
+}
+
+// Batcher's odd-even merge sort unrolled at compile time for the next power of 2 above N
+// comparators touching an index >= N are dropped, as if the missing elements were larger than everything
+template <size_t I, size_t J, size_t N, bool Used = (J < N)>
+struct Cmp_exchange {
+    template <typename Iter, typename Cmp>
+    static void run(Iter first, Cmp cmp) {
+        cswap(first + I, first + J, cmp, std::integral_constant<bool, std::is_arithmetic<Iter_value<Iter>>::value>{});
+    }
+};
+template <size_t I, size_t J, size_t N>
+struct Cmp_exchange<I, J, N, false> {
+    template <typename Iter, typename Cmp>
+    static void run(Iter, Cmp) {}
+};
+
+// comparators (i, i + R) for i in [I, End) stepping by Step
+template <size_t I, size_t End, size_t Step, size_t R, size_t N, bool More = (I < End)>
+struct Merge_step {
+    template <typename Iter, typename Cmp>
+    static void run(Iter first, Cmp cmp) {
+        Cmp_exchange<I, I + R, N>::run(first, cmp);
+        Merge_step<I + Step, End, Step, R, N>::run(first, cmp);
+    }
+};
+template <size_t I, size_t End, size_t Step, size_t R, size_t N>
+struct Merge_step<I, End, Step, R, N, false> {
+    template <typename Iter, typename Cmp>
+    static void run(Iter, Cmp) {}
+};
+
+// merge the two sorted halves of [Lo, Lo + Len) looking at every R-th element
+template <size_t Lo, size_t Len, size_t R, size_t N, bool Split = (2 * R < Len)>
+struct Odd_even_merge {
+    template <typename Iter, typename Cmp>
+    static void run(Iter first, Cmp cmp) {
+        Odd_even_merge<Lo, Len, 2 * R, N>::run(first, cmp);
+        Odd_even_merge<Lo + R, Len, 2 * R, N>::run(first, cmp);
+        Merge_step<Lo + R, Lo + Len - R, 2 * R, R, N>::run(first, cmp);
+    }
+};
+template <size_t Lo, size_t Len, size_t R, size_t N>
+struct Odd_even_merge<Lo, Len, R, N, false> {
+    template <typename Iter, typename Cmp>
+    static void run(Iter first, Cmp cmp) { Cmp_exchange<Lo, Lo + R, N>::run(first, cmp); }
+};
+
+// sort [Lo, Lo + Len) with Len a power of 2, skipping halves that lie entirely past N
+template <size_t Lo, size_t Len, size_t N, bool Work = (Len > 1 && Lo + 1 < N)>
+struct Odd_even_sort {
+    template <typename Iter, typename Cmp>
+    static void run(Iter first, Cmp cmp) {
+        Odd_even_sort<Lo, Len / 2, N>::run(first, cmp);
+        Odd_even_sort<Lo + Len / 2, Len / 2, N>::run(first, cmp);
+        Odd_even_merge<Lo, Len, 1, N>::run(first, cmp);
+    }
+};
+template <size_t Lo, size_t Len, size_t N>
+struct Odd_even_sort<Lo, Len, N, false> {
+    template <typename Iter, typename Cmp>
+    static void run(Iter, Cmp) {}
+};
+
+constexpr size_t pow2_ceil(size_t n, size_t p = 1) { return p >= n ? p : pow2_ceil(n, 2 * p); }
+
+#if defined(__AVX2__)
+// bitonic sort inside AVX2 registers for 32 and 64 bit keys, 2 registers (16 or 8 keys) at a time
+// every stage swaps lanes with a permute, takes min and max of the pair and blends them back
+// (floating point keys blend on one comparison per pair instead, see Simd_sort<float>)
+template <typename T>
+struct Simd_sort { static constexpr bool available = false; };
+
+template <>
+struct Simd_sort<int32_t> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 8;
+    using Vec = __m256i;
+    static Vec load(const int32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(int32_t* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static Vec min(Vec a, Vec b) { return _mm256_min_epi32(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm256_max_epi32(a, b); }
+    template <unsigned M>
+    static Vec exchange(Vec v, Vec p) { return blend<M>(min(v, p), max(v, p)); }
+    static void min_max(Vec a, Vec b, Vec& lo, Vec& hi) { lo = min(a, b); hi = max(a, b); }
+    template <unsigned J>
+    static Vec partner(Vec v) {
+        return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0^J, 1^J, 2^J, 3^J, 4^J, 5^J, 6^J, 7^J));
+    }
+    template <unsigned M>
+    static Vec blend(Vec a, Vec b) { return _mm256_blend_epi32(a, b, M); }
+};
+template <>
+struct Simd_sort<float> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 8;
+    using Vec = __m256;
+    static Vec load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+    // min_ps and max_ps return their second operand if either is NaN, which could keep one key twice;
+    // instead each pair of lanes decides once, on the same comparison, and swaps whole keys
+    static Vec less(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    // the lane keeping the min takes its partner if partner < it, the one keeping the max if it < partner
+    template <unsigned M>
+    static Vec exchange(Vec v, Vec p) { return _mm256_blendv_ps(v, p, _mm256_blend_ps(less(p, v), less(v, p), M)); }
+    static void min_max(Vec a, Vec b, Vec& lo, Vec& hi) {
+        const Vec swap {less(b, a)};
+        lo = _mm256_blendv_ps(a, b, swap);
+        hi = _mm256_blendv_ps(b, a, swap);
+    }
+    template <unsigned J>
+    static Vec partner(Vec v) {
+        return _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(0^J, 1^J, 2^J, 3^J, 4^J, 5^J, 6^J, 7^J));
+    }
+    template <unsigned M>
+    static Vec blend(Vec a, Vec b) { return _mm256_blend_ps(a, b, M); }
+};
+// no 64 bit min and max before AVX-512, built from a compare and a variable blend
+template <>
+struct Simd_sort<int64_t> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 4;
+    using Vec = __m256i;
+    static Vec load(const int64_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(int64_t* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static Vec min(Vec a, Vec b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+    static Vec max(Vec a, Vec b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+    template <unsigned M>
+    static Vec exchange(Vec v, Vec p) { return blend<M>(min(v, p), max(v, p)); }
+    static void min_max(Vec a, Vec b, Vec& lo, Vec& hi) { lo = min(a, b); hi = max(a, b); }
+    template <unsigned J>
+    static Vec partner(Vec v) {
+        return _mm256_permute4x64_epi64(v, (0^J) | (1^J) << 2 | (2^J) << 4 | (3^J) << 6);
+    }
+    // one mask bit per 32 bit half
+    template <unsigned M>
+    static Vec blend(Vec a, Vec b) {
+        return _mm256_blend_epi32(a, b, (M&1)*3 | (M>>1&1)*12 | (M>>2&1)*48 | (M>>3&1)*192);
+    }
+};
+template <>
+struct Simd_sort<double> {
+    static constexpr bool available = true;
+    static constexpr unsigned lanes = 4;
+    using Vec = __m256d;
+    static Vec load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, Vec v) { _mm256_storeu_pd(p, v); }
+    // whole lane swaps as for float, so a NaN can't duplicate a key
+    static Vec less(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    template <unsigned M>
+    static Vec exchange(Vec v, Vec p) { return _mm256_blendv_pd(v, p, _mm256_blend_pd(less(p, v), less(v, p), M)); }
+    static void min_max(Vec a, Vec b, Vec& lo, Vec& hi) {
+        const Vec swap {less(b, a)};
+        lo = _mm256_blendv_pd(a, b, swap);
+        hi = _mm256_blendv_pd(b, a, swap);
+    }
+    template <unsigned J>
+    static Vec partner(Vec v) {
+        return _mm256_permute4x64_pd(v, (0^J) | (1^J) << 2 | (2^J) << 4 | (3^J) << 6);
+    }
+    template <unsigned M>
+    static Vec blend(Vec a, Vec b) { return _mm256_blend_pd(a, b, M); }
+};
+
+// lanes that keep the max in the bitonic stage comparing lane i with i ^ J, inside K-lane blocks
+// alternating ascending and descending; a lane keeps the min when it's the lower of the pair in an ascending block
+constexpr unsigned max_lanes(unsigned W, unsigned J, unsigned K, unsigned i = 0) {
+    return i == W ? 0 : ((((i & J) == 0) != ((i & K) == 0)) ? 1u << i : 0) | max_lanes(W, J, K, i + 1);
+}
+
+// stages (K, J) for K doubling up to the register width and J halving down to 1
+template <typename S, unsigned K, unsigned J, bool Done = (K > S::lanes)>
+struct Bitonic {
+    static typename S::Vec run(typename S::Vec v) {
+        typename S::Vec p {S::template partner<J>(v)};
+        v = S::template exchange<max_lanes(S::lanes, J, K)>(v, p);
+        return Bitonic<S, K, J / 2>::run(v);
+    }
+};
+template <typename S, unsigned K>
+struct Bitonic<S, K, 0, false> {
+    static typename S::Vec run(typename S::Vec v) { return Bitonic<S, 2 * K, K>::run(v); }
+};
+template <typename S, unsigned K, unsigned J>
+struct Bitonic<S, K, J, true> {
+    static typename S::Vec run(typename S::Vec v) { return v; }
+};
+
+// sort 2 registers' worth of keys in place
+template <typename T>
+void simd_sort2(T* p) {
+    using S = Simd_sort<T>;
+    constexpr unsigned W {S::lanes};
+    typename S::Vec a {Bitonic<S, 2, 1>::run(S::load(p))};
+    typename S::Vec b {Bitonic<S, 2, 1>::run(S::load(p + W))};
+    // a ascending and b reversed form a bitonic sequence, split it into the low and high halves
+    b = S::template partner<W - 1>(b);
+    typename S::Vec lo, hi;
+    S::min_max(a, b, lo, hi);
+    // a K of the full width makes the one block ascending
+    S::store(p, Bitonic<S, W, W / 2>::run(lo));
+    S::store(p + W, Bitonic<S, W, W / 2>::run(hi));
+}
+
+template <typename Iter, typename Cmp>
+struct Use_simd {
+    using T = Iter_value<Iter>;
+    static constexpr bool value = Simd_sort<T>::available && std::is_same<Cmp, std::less<T>>::value &&
+        (std::is_same<Iter, T*>::value || std::is_same<Iter, typename std::vector<T>::iterator>::value);
+};
+
+template <typename Iter>
+bool simd_small_sort(Iter, size_t, std::false_type) { return false; }
+// short ranges are padded with the largest key, which sorts to the back and is dropped
+template <typename Iter>
+bool simd_small_sort(Iter begin, size_t n, std::true_type) {
+    using T = Iter_value<Iter>;
+    constexpr size_t W {Simd_sort<T>::lanes};
+    if (n > 2 * W) return false;
+    T buf[2 * W];
+    T* p {&*begin};
+    // the padding has to sort after every key, which nothing does after a NaN
+    for (size_t i = 0; i < n; ++i) if (p[i] != p[i]) return false;
+    std::copy(p, p + n, buf);
+    for (size_t i = n; i < 2 * W; ++i) buf[i] = std::numeric_limits<T>::has_infinity ?
+        std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    simd_sort2(buf);
+    std::copy(buf, buf + n, p);
+    return true;
+}
+#else
+template <typename Iter, typename Cmp>
+struct Use_simd { static constexpr bool value = false; };
+template <typename Iter>
+bool simd_small_sort(Iter, size_t, std::false_type) { return false; }
+#endif
+
+// stable merge of sorted [begin, mid) and [mid, end) moving the left half out to a stack buffer,
+// branchless on which side the next element comes from
+// the buffer is raw storage the left half is move constructed into, so T needn't be default constructible
+template <typename Iter, typename Cmp>
+void merge_small(Iter begin, Iter mid, Iter end, Cmp cmp) {
+    using T = Iter_value<Iter>;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage[network_max];
+    T* const buf {reinterpret_cast<T*>(storage)};
+    // destroys what was constructed in buf when the merge finishes (by any path)
+    struct Buf_guard {
+        T* buf;
+        size_t len;
+        ~Buf_guard() { for (size_t i = 0; i < len; ++i) buf[i].~T(); }
+    } guard {buf, 0};
+    for (Iter cur = begin; cur != mid; ++cur, ++guard.len) ::new (static_cast<void*>(buf + guard.len)) T(std::move(*cur));
+    T* a {buf};
+    T* a_end {buf + guard.len};
+    Iter out {begin};
+    while (a != a_end && mid != end) {
+        const bool right {cmp(*mid, *a)};
+        *out++ = right ? std::move(*mid) : std::move(*a);
+        mid += right;
+        a += !right;
+    }
+    std::move(a, a_end, out);
+}
+
+}	// end namespace Network_impl
+
+// sort exactly N elements starting at first with a compile time network, N <= 16 is a good size
+template <size_t N, typename Iter, typename Cmp>
+void network_sort(Iter first, Cmp cmp) {
+    Network_impl::Odd_even_sort<0, Network_impl::pow2_ceil(N), N>::run(first, cmp);
+}
+template <size_t N, typename Iter>
+void network_sort(Iter first) { network_sort<N>(first, std::less<Iter_value<Iter>>()); }
+
+namespace Network_impl {
+template <typename Iter, typename Cmp>
+void network_switch(Iter first, size_t n, Cmp cmp) {
+    switch (n) {
+        case 2: network_sort<2>(first, cmp); break;
+        case 3: network_sort<3>(first, cmp); break;
+        case 4: network_sort<4>(first, cmp); break;
+        case 5: network_sort<5>(first, cmp); break;
+        case 6: network_sort<6>(first, cmp); break;
+        case 7: network_sort<7>(first, cmp); break;
+        case 8: network_sort<8>(first, cmp); break;
+        case 9: network_sort<9>(first, cmp); break;
+        case 10: network_sort<10>(first, cmp); break;
+        case 11: network_sort<11>(first, cmp); break;
+        case 12: network_sort<12>(first, cmp); break;
+        case 13: network_sort<13>(first, cmp); break;
+        case 14: network_sort<14>(first, cmp); break;
+        case 15: network_sort<15>(first, cmp); break;
+        case 16: network_sort<16>(first, cmp); break;
+        default: break;
+    }
+}
+}	// end namespace Network_impl
+
+// sort a random access range of up to 32 elements, a register sort for primitive keys under <
+// when built with AVX2, else a network for each half of up to 16 merged without branches
+// not stable, see Ties_indistinct for when that can't be observed
+template <typename Iter, typename Cmp>
+void small_sort(Iter begin, Iter end, Cmp cmp) {
+    using namespace Network_impl;
+    const size_t n = end - begin;
+    assert(n <= small_max);
+    if (n < 2) return;
+    if (simd_small_sort(begin, n, std::integral_constant<bool, Use_simd<Iter, Cmp>::value>{})) return;
+    if (n <= network_max) return network_switch(begin, n, cmp);
+    network_switch(begin, network_max, cmp);
+    network_switch(begin + network_max, n - network_max, cmp);
+    merge_small(begin, begin + network_max, end, cmp);
+}
+template <typename Iter>
+void small_sort(Iter begin, Iter end) { small_sort(begin, end, std::less<Iter_value<Iter>>()); }
+
+}
\ No newline at end of file
@@ -1,9 +1,13 @@
 #pragma once
 
 #include <cassert>
-#include <memory>	// unintialized_copy, get_temporary_buffer, return_temporary_buffer
+#include <memory>	// allocator_traits
+#include <type_traits>	// integral_constant
 #include <vector>
+#include "../macros.h"		// Iter_value, Iter_diff
+#include "projection.h"		// proj_cmp, Ties_indistinct
 #include "simple_sorts.h"	// lin_sort
+#include "sorting_network.h"	// small_sort
 
 #define A_RUN (pending[mid - 1].len)
 #define B_RUN (pending[mid].len)
@@ -14,10 +18,14 @@ namespace sal {
 // Timsort, much better than other sorts on nearly sorted
 // O(nlgn) time
 
-template <typename Iter>
+// a Timsort object can be kept around and called many times, reusing its merge buffer
+// Alloc supplies the merge buffer, so a caller can hand in an arena allocator
+// elements are only ever moved into the buffer, so T can be move-only and need no default constructor
+template <typename Iter, typename Cmp = std::less<Iter_value<Iter>>, typename Alloc = std::allocator<Iter_value<Iter>>>
 class Timsort {
-	using T = typename Iter::value_type;
-	using D = typename Iter::difference_type;
+	using T = Iter_value<Iter>;
+	using D = Iter_diff<Iter>;
+	using Alloc_traits = std::allocator_traits<Alloc>;
 
 	// Run characterized by start and length
 	struct Run {
@@ -31,24 +39,38 @@ class Timsort {
 	};
 
 	// constant parameters and state ------
-	std::vector<T> temp;			// temporary used to hold smaller of A and B during merge
-	std::vector<Run> pending;		// runs awaiting merge
+	Cmp cmp;
+	Alloc alloc;
+	T* temp;					// raw storage to hold smaller of A and B during merge, kept between sorts
+	size_t temp_cap;			// # elements temp has room for
+	size_t temp_peak;			// most elements temp ever had to hold
+	std::vector<Run> pending;		// runs awaiting merge, capacity kept between sorts
 	D min_gallop;				// local gallop limit, init to MIN_GALLOP
 	static constexpr D MIN_MERGE {32};
 	static constexpr D MIN_GALLOP {7};	// initial threshold for galloping
 
+public:
+	explicit Timsort(const Cmp& c = Cmp(), const Alloc& a = Alloc()) : 
+		cmp(c), alloc(a), temp{nullptr}, temp_cap{0}, temp_peak{0}, min_gallop{MIN_GALLOP} {}
+	~Timsort() { release(); }
+	// owns raw storage, don't copy
+	Timsort(const Timsort&) = delete;
+	Timsort& operator=(const Timsort&) = delete;
+
 	// main sort --------------------------
-	static void sort(Iter begin, Iter end) {
+	void operator()(Iter begin, Iter end) { sort(begin, end); }
+	void sort(Iter begin, Iter end) {
 		assert(begin <= end);
 		D elems_left {end - begin};
 		if (elems_left < 2) return;	// 0 or 1 elements base case already sorted
 		if (elems_left < MIN_MERGE) {	// becomes glorified insertion sort
 			const D init_run {find_run(begin, end)};
-			lin_sort(begin, end, begin + init_run);	// init_run already sorted
+			base_sort(begin, end, begin + init_run);
 			return;
 		}
 		// else multiple runs exist
-		Timsort<Iter> sorter {};
+		pending.clear();
+		min_gallop = MIN_GALLOP;
 		const D min_run {compute_minrun(elems_left)};
 		auto cur = begin;
 		do {
@@ -56,12 +78,12 @@ class Timsort {
 			// force into a min_run
 			if (cur_run < min_run) {
 				D left {std::min(elems_left, min_run)};
-				lin_sort(cur, cur + left, cur + cur_run);
+				base_sort(cur, cur + left, cur + cur_run);
 				cur_run = left; 
 			}
 
-			sorter.push_run(cur, cur_run);
-			sorter.collapse();	// merge according to invariants
+			push_run(cur, cur_run);
+			collapse();	// merge according to invariants
 
 			cur 	   += cur_run;
 			elems_left -= cur_run;
@@ -69,10 +91,21 @@ class Timsort {
 
 		assert(cur == end);
 		// collapse all remaining runs
-		sorter.force_collapse();
-		assert(sorter.pending.size() == 1);
+		force_collapse();
+		assert(pending.size() == 1);
+	}
+
+	// scratch usage in elements, multiply by sizeof(T) for bytes
+	size_t capacity() const { return temp_cap; }
+	size_t peak() const { return temp_peak; }
+	// give back the merge buffer, next sort will allocate again
+	void release() {
+		if (temp) Alloc_traits::deallocate(alloc, temp, temp_cap);
+		temp = nullptr;
+		temp_cap = 0;
 	}
 
+private:
 	// helpers ----------------------------
 	// want minrun size st. N/minrun is <= pow2 for even merging
 	static D compute_minrun(D n) {
@@ -85,17 +118,25 @@ class Timsort {
 		return n + r;
 	}
 
+	// sort [begin, end) of at most MIN_MERGE elements where [begin, sorted) is already in order
+	// equal integers can't be told apart, so stability allows a network for them
+	void base_sort(Iter begin, Iter end, Iter sorted) {
+		base_sort(begin, end, sorted, std::integral_constant<bool, Ties_indistinct<Cmp, T>::value>{});
+	}
+	void base_sort(Iter begin, Iter end, Iter, std::true_type) { small_sort(begin, end, cmp); }
+	void base_sort(Iter begin, Iter end, Iter sorted, std::false_type) { lin_sort(begin, end, sorted, cmp); }
+
 	// find length of next run and make ascending if descending
-	static D find_run(const Iter begin, const Iter end) {
+	D find_run(const Iter begin, const Iter end) {
 		assert(begin < end);
 		auto run_end = begin + 1;
 		if (run_end == end) return 1;
-		if (*run_end < *begin) {	// descending run
-			while (run_end != end && *run_end < *(run_end - 1)) ++run_end;
+		if (cmp(*run_end, *begin)) {	// descending run
+			while (run_end != end && cmp(*run_end, *(run_end - 1))) ++run_end;
 			std::reverse(begin, run_end);	// make ascending 
 		}
 		else 	// ascending run
-			while (run_end != end && *run_end >= *(run_end - 1)) ++run_end;
+			while (run_end != end && !cmp(*run_end, *(run_end - 1))) ++run_end;
 		
 		return run_end - begin;
 	}
@@ -179,19 +220,19 @@ class Timsort {
 	void merge_low(const Iter start_a, D len_a, const Iter start_b, D len_b) {
 		
 		assert(len_a > 0 && len_b > 0 && (start_a + len_a == start_b));
-		make_temp(start_a, len_a);
-		Iter cur_a {temp.begin()};
+		Temp_guard guard {*this, make_temp(start_a, len_a)};
+		T* cur_a {temp};
 		Iter cur_b {start_b};
 		Iter dest {start_a};
 
-		*(dest++) = *(cur_b++);
+		*(dest++) = std::move(*(cur_b++));
 		if (--len_b == 0) {
-			std::copy(cur_a, cur_a + len_a, dest);
+			std::move(cur_a, cur_a + len_a, dest);
 			return;
 		}
 		if (len_a == 1) {
-			std::copy(cur_b, cur_b + len_b, dest);
-			dest[len_b] = *cur_a;	// last element of A is last
+			std::move(cur_b, cur_b + len_b, dest);
+			dest[len_b] = std::move(*cur_a);	// last element of A is last
 			return;
 		}
 
@@ -202,14 +243,14 @@ class Timsort {
 			// merge one pair at a time until min_gallop reached
 			do {
 				assert(len_a > 1 && len_b > 0);
-				if (*cur_b < *cur_a) { // B win
-					*(dest++) = *(cur_b++);
+				if (cmp(*cur_b, *cur_a)) { // B win
+					*(dest++) = std::move(*(cur_b++));
 					++score_b;
 					score_a = 0;
 					if (--len_b == 0) goto release;
 				}
 				else {	// A win
-					*(dest++) = *(cur_a++);
+					*(dest++) = std::move(*(cur_a++));
 					++score_a;
 					score_b = 0;
 					if (--len_a == 1) goto release;
@@ -225,25 +266,25 @@ class Timsort {
 				
 				score_a = gallop_r(*cur_b, cur_a, len_a, 0);
 				if (score_a) {
-					std::copy_backward(cur_a, cur_a + score_a, dest + score_a);
+					std::move(cur_a, cur_a + score_a, dest);
 					dest  += score_a;
 					cur_a += score_a;
 					len_a -= score_a;
 					if (len_a <= 1) goto release;
 				}
-				*(dest++) = *(cur_b++);
+				*(dest++) = std::move(*(cur_b++));
 				if (--len_b == 0) goto release;
 				// gallop for A[0] in B
 				
 				score_b = gallop_l(*cur_a, cur_b, len_b, 0);
 				if (score_b) {
-					std::copy(cur_b, cur_b + score_b, dest);
+					std::move(cur_b, cur_b + score_b, dest);
 					dest  += score_b;
 					cur_b += score_b;
 					len_b -= score_b;
 					if (len_b == 0) goto release;
 				}
-				*(dest++) = *(cur_a++);
+				*(dest++) = std::move(*(cur_a++));
 				if (--len_a == 1) goto release;
 
 			} while (score_a >= MIN_GALLOP || score_b >= MIN_GALLOP);
@@ -254,13 +295,13 @@ class Timsort {
 		release:
 		if (len_a == 1) {
 			assert(len_b > 0);
-			std::copy(cur_b, cur_b + len_b, dest);
-			dest[len_b] = *cur_a;
+			std::move(cur_b, cur_b + len_b, dest);
+			dest[len_b] = std::move(*cur_a);
 		}
 		else {	// error, copies over rest of A
 			assert(len_a > 1);
 			assert(len_b == 0);
-			std::copy(cur_a, cur_a + len_a, dest);
+			std::move(cur_a, cur_a + len_a, dest);
 		}
 	}
 
@@ -269,21 +310,21 @@ class Timsort {
 	void merge_high(const Iter start_a, D len_a, const Iter start_b, D len_b) {
         assert( len_a > 0 && len_b > 0 && start_a + len_a == start_b );
         
-		make_temp(start_b, len_b);	// b is temp since it's smaller
+		Temp_guard guard {*this, make_temp(start_b, len_b)};	// b is temp since it's smaller
 		Iter cur_a {start_a + (len_a - 1)};
-		Iter cur_b {temp.begin() + (len_b - 1)};
+		T* cur_b {temp + (len_b - 1)};
 		Iter dest {start_b + (len_b - 1)};
 
-		*(dest--) = *(cur_a--);
+		*(dest--) = std::move(*(cur_a--));
 		if (--len_a == 0) {
-			std::copy(temp.begin(), temp.begin() + len_b, dest - (len_b - 1));
+			std::move(temp, temp + len_b, dest - (len_b - 1));
 			return; 
 		}
 		if (len_b == 1) {
 			dest  -= len_a;
 			cur_a -= len_a;
-			std::copy_backward(cur_a + 1, cur_a + (len_a + 1), dest + (len_a + 1));
-			*dest = *cur_b;	// last element of B is last
+			std::move_backward(cur_a + 1, cur_a + (len_a + 1), dest + (len_a + 1));
+			*dest = std::move(*cur_b);	// last element of B is last
 			return;
 		}
 
@@ -296,14 +337,14 @@ class Timsort {
 			do {
 				assert(len_a > 0 && len_b > 1);
 				
-				if (*cur_b < *cur_a) {	// A win
-					*(dest--) = *(cur_a--);
+				if (cmp(*cur_b, *cur_a)) {	// A win
+					*(dest--) = std::move(*(cur_a--));
 					++score_a;
 					score_b = 0;
 					if (--len_a == 0) goto release; // success
 				}
 				else { // B win
-					*(dest--) = *(cur_b--);
+					*(dest--) = std::move(*(cur_b--));
 					++score_b;
 					score_a = 0;
 					if (--len_b == 1) goto release; // copy A over
@@ -319,25 +360,25 @@ class Timsort {
 				
 				score_a = len_a - gallop_r(*cur_b, start_a, len_a, len_a - 1);
 				if (score_a) {
-					std::copy_backward(cur_a - score_a + 1, cur_a + 1, dest + 1);
+					std::move_backward(cur_a - score_a + 1, cur_a + 1, dest + 1);
 					dest  -= score_a;
 					cur_a -= score_a;
 					len_a -= score_a;
 					if (len_a == 0) goto release;// success
 				}
-				*(dest--) = *(cur_b--);
+				*(dest--) = std::move(*(cur_b--));
 				if (--len_b == 1) goto release; // copy A over
 				// gallop for A[0] in B
 				
-				score_b = len_b - gallop_l(*cur_a, temp.begin(), len_b, len_b - 1);  
+				score_b = len_b - gallop_l(*cur_a, temp, len_b, len_b - 1);  
 				if (score_b) {
 					dest  -= score_b;
 					cur_b -= score_b;
 					len_b -= score_b;
-					std::copy(cur_b + 1, cur_b + (score_b + 1), dest + 1);
+					std::move(cur_b + 1, cur_b + (score_b + 1), dest + 1);
 					if (len_b <= 1) goto release;
 				}
-				*(dest--) = *(cur_a--);
+				*(dest--) = std::move(*(cur_a--));
 				if (--len_a == 0) goto release;
 			} while (score_a >= MIN_GALLOP || score_b >= MIN_GALLOP);
 			++min_gallop;		// penalty for leaving gallop
@@ -349,22 +390,39 @@ class Timsort {
 			assert(len_a > 0);
 			dest  -= len_a;
 			cur_a -= len_a;
-			std::copy_backward(cur_a + 1, cur_a + (len_a + 1), dest + (len_a + 1));
-			*dest = *cur_b;
+			std::move_backward(cur_a + 1, cur_a + (len_a + 1), dest + (len_a + 1));
+			*dest = std::move(*cur_b);
 		}
 		else {	// error, copies over rest of B
 			assert(len_a == 0);
 			assert(len_b > 1);
-			std::copy(temp.begin(), temp.begin() + len_b, dest - (len_b - 1));
+			std::move(temp, temp + len_b, dest - (len_b - 1));
 		}
 	}
 
-	// remember to std::return_temporary_buffer after
-	void make_temp(const Iter start, D len) {
-		temp.clear();
-		temp.reserve(len);
-		std::copy(start, start+len, std::back_inserter(temp));
+	// move len elements from start into temp, growing it geometrically if it's too small
+	// returns len so the caller's guard knows how many to destroy
+	D make_temp(const Iter start, D len) {
+		if ((size_t)len > temp_cap) {
+			// temp holds no live elements between merges, so old storage can be dropped without moving
+			size_t new_cap {std::max((size_t)len, temp_cap * 2)};
+			release();
+			temp = Alloc_traits::allocate(alloc, new_cap);
+			temp_cap = new_cap;
+		}
+		if ((size_t)len > temp_peak) temp_peak = len;
+		for (D i = 0; i < len; ++i) 
+			Alloc_traits::construct(alloc, temp + i, std::move(start[i]));
+		return len;
 	}
+	// destroys the moved-from elements left in temp when a merge finishes (by any path)
+	struct Temp_guard {
+		Timsort& sorter;
+		D len;
+		~Temp_guard() {
+			for (D i = 0; i < len; ++i) Alloc_traits::destroy(sorter.alloc, sorter.temp + i);
+		}
+	};
 
 	// ------- Galloping
 	// compare A[0] to B[0], B[1], B[3] .. B[2**j - 1] until B[2**(k-1) - 1] < A[0] <= B[2**k - 1]
@@ -381,15 +439,16 @@ class Timsort {
 	}
 
 	// finds index s.t. A[index-1] < key <= A[index], start is start of A (a run)
-	D gallop_l(T key, Iter start, D len, D hint) {		
+	template <typename It>
+	D gallop_l(const T& key, It start, D len, D hint) {		
 		assert(len > 0 && hint >= 0 && hint < len);
 		D offset {1};
 		D offset_prev {};
 		start += hint; 
-		if (key > *start) {
+		if (cmp(*start, key)) {
 			// A[hint] < key, gallop right until a[offset + offset_prev] < key <= A[hint + offset] 
 			const D offset_max {len - hint};
-			while (offset < offset_max && key > *(start + offset)) 
+			while (offset < offset_max && cmp(*(start + offset), key)) 
 				gallop_shift(offset, offset_prev, offset_max);
 			if (offset > offset_max) offset = offset_max;	// overshot
 			// translate by hint
@@ -399,7 +458,7 @@ class Timsort {
 		else {
 			// A[hint] >= key, gallop left until a[hint - offset] < key <= A[hint - offset_prev] 
 			const D offset_max {hint + 1};
-			while (offset < offset_max && key <= *(start - offset))
+			while (offset < offset_max && !cmp(*(start - offset), key))
 				gallop_shift(offset, offset_prev, offset_max);
 			if (offset > offset_max) offset = offset_max;
 			// translating by hint
@@ -410,18 +469,19 @@ class Timsort {
 		start -= hint;
 		// A[offset_prev] < key <= A[offset], binary search
 		assert(-1 <= offset_prev && offset_prev < offset && offset <= len);
-		return std::lower_bound(start + (offset_prev+1), start + offset, key) - start;
+		return std::lower_bound(start + (offset_prev+1), start + offset, key, cmp) - start;
 	}
 	// like gallop_l but A[index-1] <= key < A[index], so use upper bound
-	D gallop_r(T key, Iter start, D len, D hint) {
+	template <typename It>
+	D gallop_r(const T& key, It start, D len, D hint) {
 		assert(len > 0 && hint >= 0 && hint < len);
 		D offset {1};
 		D offset_prev {};
 		start += hint;
-		if (key < *start) {
+		if (cmp(key, *start)) {
 			// A[hint] > key, gallop left until a[hint - offset] <= key < A[hint - offset_prev] 
 			const D offset_max {hint + 1};
-			while (offset < offset_max && key < *(start - offset)) 
+			while (offset < offset_max && cmp(key, *(start - offset))) 
 				gallop_shift(offset, offset_prev, offset_max);
 			if (offset > offset_max) offset = offset_max;
 			// translating by hint
@@ -432,7 +492,7 @@ class Timsort {
 		else {
 			// A[hint] <= key, gallop right until a[offset + offset_prev] <= key < A[hint + offset] 
 			const D offset_max {len - hint};
-			while (offset < offset_max && key >= *(start + offset))
+			while (offset < offset_max && !cmp(key, *(start + offset)))
 				gallop_shift(offset, offset_prev, offset_max);
 			if (offset > offset_max) offset = offset_max;	// overshot
 			// translate by hint
@@ -442,20 +502,21 @@ class Timsort {
 		start -= hint;
 		// A[offset_prev] < key <= A[offset], binary search
 		assert(-1 <= offset_prev && offset_prev < offset && offset <= len);
-		return std::upper_bound(start + (offset_prev+1), start + offset, key) - start;
+		return std::upper_bound(start + (offset_prev+1), start + offset, key, cmp) - start;
 	}
-
-	// constructor min_gallop
-	Timsort() : min_gallop{MIN_GALLOP} {}
-
-	// interface  -------------------------
-	template <typename Iter_>
-	friend void tim_sort(Iter_ begin, Iter_ end);
 };
 
-template <typename Iter>
-void tim_sort(const Iter begin, const Iter end) {
-	Timsort<Iter>::sort(begin, end);
+// one-off sort, keep a Timsort object around instead when sorting many sequences
+template <typename Iter, typename Cmp>
+void tim_sort(const Iter begin, const Iter end, Cmp cmp) {
+	Timsort<Iter, Cmp> sorter {cmp};
+	sorter.sort(begin, end);
 }
+template <typename Iter, typename Cmp, typename Proj>
+void tim_sort(const Iter begin, const Iter end, Cmp cmp, Proj proj) { tim_sort(begin, end, proj_cmp(cmp, proj)); }
+template <typename Iter>
+void tim_sort(const Iter begin, const Iter end) { tim_sort(begin, end, std::less<Iter_value<Iter>>()); }
+template <typename Container>
+void tim_sort(Container& c) { tim_sort(c.begin(), c.end()); }
 
 }
\ No newline at end of file
@@ -1,9 +1,26 @@
 #include <vector>
 #include <algorithm>
+#include <numeric>		// accumulate
+#include <random>
+#include <cmath>		// isnan
+#include <limits>		// numeric_limits
 #include <iostream>
 #include "../prime.h"
 #include "../utility.h"
 #include "../sort/partition.h"
+#include "../sort/comparison_sorts.h"
+#include "../sort/adaptive_sort.h"
+#include "../sort/external_sort.h"
+#include "../sort/multiway_merge.h"
+#include "../sort/patience_sort.h"
+#include "../search/element_select.h"
+#include "../search/static_search.h"
+#include "../search/learned_index.h"
+#include "../search/sorted_sets.h"
+#include "../search/string_search.h"
+#include "../search/aho_corasick.h"
+#include "../search/stream_search.h"
+#include "../search/Suffix_array.h"
 
 using namespace std;
 using namespace sal;
@@ -43,9 +60,730 @@ void profile_partition() {
 	cout << time.tonow() / 1000.0 << " ms\n";		
 }
 
+// standard distributions that quicksorts tend to be weak on
+vector<int> sort_input(const string& dist, size_t n) {
+	vector<int> vals;
+	for (size_t i = 0; i < n; ++i) vals.push_back(i);
+	if (dist == "random") random_shuffle(begin(vals), end(vals));
+	else if (dist == "reversed") reverse(begin(vals), end(vals));
+	else if (dist == "few unique") for (auto& v : vals) v = randint(16);
+	else if (dist == "organ pipe") for (size_t i = n/2; i < n; ++i) vals[i] = n - i;
+	else if (dist == "perturbed") perturb(begin(vals), end(vals), 16);
+	return vals;	// sorted
+}
+
+void profile_qck_sort(size_t n) {
+	for (string dist : {"random", "sorted", "reversed", "few unique", "organ pipe", "perturbed"}) {
+		vector<int> vals {sort_input(dist, n)};
+		cout << dist << endl;
+
+		vector<int> temp_vals {vals};
+		Timer time;
+		std::sort(begin(temp_vals), end(temp_vals));
+		cout << "std sort " << time.tonow() / 1000.0 << " ms\n";
+
+		temp_vals = vals;
+		time.restart();
+		sal::qck_sort(begin(temp_vals), end(temp_vals));
+		cout << "qck_sort " << time.tonow() / 1000.0 << " ms\n";
+
+		// plain quicksort only on random, others recurse too deep
+		if (dist != "random") continue;
+		temp_vals = vals;
+		time.restart();
+		sal::quick_sort(begin(temp_vals), end(temp_vals) - 1);
+		cout << "quick_sort " << time.tonow() / 1000.0 << " ms\n";
+	}
+}
+
+// with a NaN among doubles nothing is in order, but every sort still has to give back a permutation of its input
+// (register sorts and their padding used to lose keys to it)
+void check_nan_sort() {
+	mt19937 engine {1};
+	auto nan_last = [](double a, double b) { return std::isnan(b) ? !std::isnan(a) : a < b; };
+	auto same_keys = [&](vector<double> a, vector<double> b) {
+		std::sort(begin(a), end(a), nan_last);
+		std::sort(begin(b), end(b), nan_last);
+		return equal(begin(a), end(a), begin(b), [](double x, double y) { return x == y || (std::isnan(x) && std::isnan(y)); });
+	};
+	size_t lost[3] {};
+	for (size_t n = 2; n <= 200; ++n)
+		for (int rep = 0; rep < 10; ++rep) {
+			vector<double> vals(n);
+			for (auto& v : vals) v = engine() % 1000;
+			vals[engine() % n] = numeric_limits<double>::quiet_NaN();
+			vector<double> temp_vals {vals};
+			pdq_sort(begin(temp_vals), end(temp_vals));
+			lost[0] += !same_keys(vals, temp_vals);
+			temp_vals = vals;
+			sal::sort(begin(temp_vals), end(temp_vals));
+			lost[1] += !same_keys(vals, temp_vals);
+			if (n > 32) continue;	// small_sort's limit
+			temp_vals = vals;
+			small_sort(begin(temp_vals), end(temp_vals));
+			lost[2] += !same_keys(vals, temp_vals);
+		}
+	if (lost[0] || lost[1] || lost[2]) cout << "sorting with a NaN FAILED to keep the keys: pdq_sort " << lost[0]
+		<< ", sal::sort " << lost[1] << ", small_sort " << lost[2] << " of 1990 inputs\n";
+}
+
+// every distribution against each sort sal::sort can pick, and the sort it picked
+void profile_sal_sort(size_t n) {
+	cout << "dist\tstd\tsal\tqck\ttim\tmer\trdx\tcnt\tpicked (ms)\n";
+	for (string dist : {"random", "sorted", "reversed", "few unique", "organ pipe", "perturbed"}) {
+		vector<int> vals {sort_input(dist, n)};
+		auto ms = [&vals](void (*sorter)(vector<int>&)) {
+			vector<int> temp_vals {vals};
+			Timer time;
+			sorter(temp_vals);
+			return time.tonow() / 1000.0;
+		};
+		const char* picked {""};
+		vector<int> temp_vals {vals};
+		Timer time;
+		sal::sort(begin(temp_vals), end(temp_vals), less<int>(),
+			[&picked](const Sort_decision& d) { picked = sort_kernel_name(d.kernel); });
+		double sal_ms {time.tonow() / 1000.0};
+
+		cout << dist << '\t' << ms([](vector<int>& v) { std::sort(begin(v), end(v)); }) << '\t' << sal_ms
+			<< '\t' << ms([](vector<int>& v) { qck_sort(begin(v), end(v)); })
+			<< '\t' << ms([](vector<int>& v) { tim_sort(begin(v), end(v)); })
+			<< '\t' << ms([](vector<int>& v) { mer_sort(begin(v), end(v)); })
+			<< '\t' << ms([](vector<int>& v) { rdx_sort(begin(v), end(v)); })
+			<< '\t' << ms([](vector<int>& v) { cnt_sort(begin(v), end(v)); })
+			<< '\t' << picked << '\n';
+	}
+}
+
+// mer_sort and par_mer_sort against std::stable_sort, on keys with many ties so stability shows
+void profile_mer_sort(size_t n) {
+	mt19937 engine {1};
+	uniform_int_distribution<int> key {0, 1000};
+	vector<pair<int, size_t>> vals;
+	for (size_t i = 0; i < n; ++i) vals.emplace_back(key(engine), i);
+	auto by_key = [](const pair<int, size_t>& a, const pair<int, size_t>& b) { return a.first < b.first; };
+	vector<pair<int, size_t>> sorted {vals};
+	Timer time;
+	std::stable_sort(begin(sorted), end(sorted), by_key);
+	cout << n << " pairs: std::stable_sort " << time.tonow() / 1000.0 << " ms";
+	for (unsigned threads : {1u, 4u}) {
+		vector<pair<int, size_t>> temp_vals {vals};
+		time.restart();
+		if (threads == 1) mer_sort(begin(temp_vals), end(temp_vals), by_key);
+		else par_mer_sort(begin(temp_vals), end(temp_vals), by_key, threads);
+		cout << ", " << (threads == 1 ? "mer_sort " : "par_mer_sort (4 threads) ") << time.tonow() / 1000.0 << " ms"
+			<< (temp_vals != sorted ? " FAILED" : "");
+	}
+	cout << '\n';
+}
+
+// k sorted runs of (key, run) pairs merged, against sorting them all; ties between runs have to keep run order
+void profile_multiway_merge(size_t n, size_t k) {
+	mt19937 engine {1};
+	uniform_int_distribution<int> key {0, 1000};
+	using Item = pair<int, size_t>;
+	vector<vector<Item>> runs(k);
+	for (size_t r = 0; r < k; ++r) {
+		for (size_t i = 0; i < n / k; ++i) runs[r].emplace_back(key(engine), r);
+		std::sort(begin(runs[r]), end(runs[r]));
+	}
+	vector<Item> all;
+	for (const auto& run : runs) all.insert(end(all), begin(run), end(run));
+	auto by_key = [](const Item& a, const Item& b) { return a.first < b.first; };
+	Timer time;
+	std::stable_sort(begin(all), end(all), by_key);
+	cout << n << " pairs in " << k << " runs: std::stable_sort " << time.tonow() / 1000.0 << " ms";
+
+	vector<pair<vector<Item>::const_iterator, vector<Item>::const_iterator>> ranges;
+	for (const auto& run : runs) ranges.emplace_back(begin(run), end(run));
+	for (unsigned threads : {1u, 4u}) {
+		vector<Item> merged(all.size());
+		time.restart();
+		if (threads == 1) multiway_merge(ranges, begin(merged), by_key);
+		else par_multiway_merge(ranges, begin(merged), by_key, threads);
+		cout << ", " << (threads == 1 ? "multiway_merge " : "par_multiway_merge (4 threads) ") << time.tonow() / 1000.0
+			<< " ms" << (merged != all ? " FAILED" : "");
+	}
+	cout << '\n';
+}
+
+// pat_sort on strings (moved through the piles, never copied), random and nearly sorted, against std::sort
+void profile_pat_sort(size_t n) {
+	mt19937 engine {1};
+	uniform_int_distribution<int> letter {'a', 'z'};
+	vector<string> random_words(n);
+	for (auto& w : random_words) for (int l = 0; l < 12; ++l) w += static_cast<char>(letter(engine));
+	vector<string> nearly {random_words};
+	std::sort(begin(nearly), end(nearly));
+	perturb(begin(nearly), end(nearly), 16);
+	for (const vector<string>* vals : {&random_words, &nearly}) {
+		vector<string> sorted {*vals};
+		Timer time;
+		std::sort(begin(sorted), end(sorted));
+		const double std_ms {time.tonow() / 1000.0};
+		vector<string> temp_vals {*vals};
+		time.restart();
+		pat_sort(begin(temp_vals), end(temp_vals));
+		cout << n << (vals == &nearly ? " nearly sorted" : " random") << " strings: std::sort " << std_ms << " ms, pat_sort "
+			<< time.tonow() / 1000.0 << " ms" << (temp_vals != sorted ? " FAILED" : "") << '\n';
+	}
+}
+
+// bucket_sort with each kernel, on one thread and on 4, against std::sort
+void profile_bucket_sort(size_t n) {
+	mt19937 engine {1};
+	uniform_real_distribution<double> uniform {0, 1e6};
+	vector<double> vals(n);
+	for (auto& v : vals) v = uniform(engine);
+	vector<double> sorted {vals};
+	Timer time;
+	std::sort(begin(sorted), end(sorted));
+	cout << n << " uniform doubles: std::sort " << time.tonow() / 1000.0 << " ms";
+	auto run = [&](const char* name, unsigned threads, void (*sorter)(vector<double>&, unsigned)) {
+		vector<double> temp_vals {vals};
+		time.restart();
+		sorter(temp_vals, threads);
+		cout << ", " << name << (threads > 1 ? " (4 threads) " : " ") << time.tonow() / 1000.0 << " ms"
+			<< (temp_vals != sorted ? " FAILED" : "");
+	};
+	for (unsigned threads : {1u, 4u}) {
+		run("Bucket_pdq", threads, [](vector<double>& v, unsigned th) {
+			bucket_sort(begin(v), end(v), Number_bucket_hash{begin(v), end(v), v.size() / 16}, Bucket_pdq{}, th);
+		});
+		run("Bucket_ins", threads, [](vector<double>& v, unsigned th) {
+			bucket_sort(begin(v), end(v), Number_bucket_hash{begin(v), end(v), v.size() / 4}, Bucket_ins{}, th);
+		});
+		run("Bucket_recursive", threads, [](vector<double>& v, unsigned th) {
+			bucket_sort(begin(v), end(v), Number_bucket_hash{begin(v), end(v), 1024}, Bucket_recursive<Bucket_pdq>{}, th);
+		});
+	}
+	cout << '\n';
+}
+
+// counting sorts on keys spread over all of int fall back to pdq_sort rather than a 2^32 histogram
+void profile_cnt_sort_span(size_t n) {
+	mt19937 engine {1};
+	uniform_int_distribution<int> full {numeric_limits<int>::min(), numeric_limits<int>::max()};
+	vector<int> vals(n);
+	for (auto& v : vals) v = full(engine);
+	vals[0] = numeric_limits<int>::min();
+	vals[1] = numeric_limits<int>::max();
+	vector<int> sorted {vals};
+	Timer time;
+	std::sort(begin(sorted), end(sorted));
+	cout << n << " full width ints: std::sort " << time.tonow() / 1000.0 << " ms";
+	for (string kind : {"cnt_sort", "par_cnt_sort", "cnt_sort_inplace"}) {
+		vector<int> temp_vals {vals};
+		time.restart();
+		if (kind == "cnt_sort") cnt_sort(begin(temp_vals), end(temp_vals));
+		else if (kind == "par_cnt_sort") par_cnt_sort(begin(temp_vals), end(temp_vals));
+		else cnt_sort_inplace(begin(temp_vals), end(temp_vals));
+		cout << ", " << kind << ' ' << time.tonow() / 1000.0 << " ms";
+		if (temp_vals != sorted) cout << " FAILED";
+		// a span that wraps to 0 in int
+		vector<int> wraps {numeric_limits<int>::max(), 5, numeric_limits<int>::min(), 0};
+		if (kind == "cnt_sort") cnt_sort(begin(wraps), end(wraps));
+		else if (kind == "par_cnt_sort") par_cnt_sort(begin(wraps), end(wraps));
+		else cnt_sort_inplace(begin(wraps), end(wraps));
+		if (!is_sorted(begin(wraps), end(wraps))) cout << ' ' << kind << " on {INT_MAX, 5, INT_MIN, 0} FAILED";
+	}
+	cout << '\n';
+}
+
+// ext_sort with memory budgets far below the data, multi pass with fan in 2, against std::sort in memory
+void profile_ext_sort(size_t n) {
+	const string in_path {"sal_ext_in.tmp"}, out_path {"sal_ext_out.tmp"};
+	mt19937 engine {1};
+	uniform_int_distribution<int> full {numeric_limits<int>::min(), numeric_limits<int>::max()};
+	vector<int> vals(n);
+	for (auto& v : vals) v = full(engine);
+	{
+		std::FILE* out {std::fopen(in_path.c_str(), "wb")};
+		std::fwrite(vals.data(), sizeof(int), n, out);
+		std::fclose(out);
+	}
+	Timer time;
+	std::sort(begin(vals), end(vals));
+	cout << n << " ints: std::sort in memory " << time.tonow() / 1000.0 << " ms\n";
+	for (size_t memory : {size_t{1} << 16, size_t{1} << 22})
+		for (size_t fan_in : {2, 64}) {
+			time.restart();
+			Ext_sort_stats stats {ext_sort<int>(in_path, out_path, Ext_sort_config{memory, fan_in})};
+			const double ms {time.tonow() / 1000.0};
+			vector<int> sorted(n + 1);
+			std::FILE* in {std::fopen(out_path.c_str(), "rb")};
+			const size_t got {std::fread(sorted.data(), sizeof(int), n + 1, in)};
+			std::fclose(in);
+			sorted.resize(got);
+			cout << memory / 1024 << " KB, fan in " << fan_in << ": " << stats.runs << " runs, " << stats.passes
+				<< " passes, " << ms << " ms" << (sorted != vals ? " ext_sort FAILED" : "") << '\n';
+		}
+	// errors come back as runtime_error
+	bool threw {false};
+	try { ext_sort<int>(in_path, "sal_no_such_dir/out.tmp"); }
+	catch (const runtime_error&) { threw = true; }
+	if (!threw) cout << "ext_sort to a missing directory FAILED to throw\n";
+	std::remove(in_path.c_str());
+	std::remove(out_path.c_str());
+}
+
+// median and 99th percentile against std::nth_element
+void profile_select(size_t n) {
+	for (string dist : {"random", "sorted", "reversed", "few unique", "organ pipe", "perturbed"}) {
+		vector<int> vals {sort_input(dist, n)};
+		for (size_t k : {n / 2, n * 99 / 100}) {
+			vector<int> temp_vals {vals};
+			Timer time;
+			std::nth_element(begin(temp_vals), begin(temp_vals) + k, end(temp_vals));
+			double std_ms {time.tonow() / 1000.0};
+
+			temp_vals = vals;
+			time.restart();
+			nth_select(begin(temp_vals), begin(temp_vals) + k, end(temp_vals));
+			cout << dist << ' ' << k << "th: std " << std_ms << " ms, nth_select " << time.tonow() / 1000.0 << " ms\n";
+		}
+	}
+}
+
+// min_max and sum against std::minmax_element and accumulate, then int64 and double keys
+void profile_min_max(size_t n) {
+	vector<int> vals {sort_input("random", n)};
+	Timer time;
+	auto std_mm = std::minmax_element(begin(vals), end(vals));
+	double std_ms {time.tonow() / 1000.0};
+	time.restart();
+	auto mm = min_max(begin(vals), end(vals));
+	double sal_ms {time.tonow() / 1000.0};
+	time.restart();
+	auto par_mm = par_min_max(begin(vals), end(vals));
+	double par_ms {time.tonow() / 1000.0};
+	if (mm.first != *std_mm.first || mm.second != *std_mm.second || par_mm != mm) cout << "min_max FAILED\n";
+	cout << "minmax_element " << std_ms << " ms, min_max " << sal_ms << " ms, par_min_max " << par_ms << " ms\n";
+
+	time.restart();
+	long long std_sum {accumulate(begin(vals), end(vals), 0LL)};
+	std_ms = time.tonow() / 1000.0;
+	time.restart();
+	if (sum(begin(vals), end(vals)) != std_sum) cout << "sum FAILED\n";
+	cout << "accumulate " << std_ms << " ms, sum " << time.tonow() / 1000.0 << " ms\n";
+
+	vector<long> longs(begin(vals), end(vals));
+	vector<double> doubles(begin(vals), end(vals));
+	time.restart();
+	auto l_std = std::minmax_element(begin(longs), end(longs));
+	std_ms = time.tonow() / 1000.0;
+	time.restart();
+	if (min_max(begin(longs), end(longs)).second != *l_std.second) cout << "min_max FAILED\n";
+	cout << "int64 minmax_element " << std_ms << " ms, min_max " << time.tonow() / 1000.0 << " ms\n";
+	time.restart();
+	auto d_std = std::minmax_element(begin(doubles), end(doubles));
+	std_ms = time.tonow() / 1000.0;
+	time.restart();
+	if (min_max(begin(doubles), end(doubles)).second != *d_std.second) cout << "min_max FAILED\n";
+	cout << "double minmax_element " << std_ms << " ms, min_max " << time.tonow() / 1000.0 << " ms\n";
+}
+
+// ns per lookup of random keys, half of them present, in n sorted ints; batched looks them all up in one call
+void profile_static_search(size_t n) {
+	vector<int> vals(n);
+	for (size_t i = 0; i < n; ++i) vals[i] = 2 * i;
+	const size_t lookups {1000000};
+	vector<int> keys(lookups);
+	mt19937 engine {1};	// randint keeps the range of its first call
+	uniform_int_distribution<int> die {0, (int)(2 * n)};
+	for (auto& k : keys) k = die(engine);
+
+	size_t std_found {0}, bin_found {0}, eyt_found {0};
+	Timer time;
+	for (int k : keys) std_found += lower_bound(begin(vals), end(vals), k) - begin(vals);
+	double std_ns {time.tonow() * 1000.0 / lookups};
+	time.restart();
+	for (int k : keys) bin_found += bin_search(begin(vals), end(vals), k) != end(vals);
+	double bin_ns {time.tonow() * 1000.0 / lookups};
+	Eytzinger<int> eyt {vals};
+	time.restart();
+	for (int k : keys) eyt_found += eyt.lower_bound(k);
+	double eyt_ns {time.tonow() * 1000.0 / lookups};
+	if (std_found != eyt_found) cout << "Eytzinger FAILED\n";
+	vector<size_t> positions(lookups);
+	time.restart();
+	bin_search(begin(vals), end(vals), begin(keys), end(keys), begin(positions));
+	double batch_ns {time.tonow() * 1000.0 / lookups};
+	if (count(begin(positions), end(positions), n) != (long)(lookups - bin_found)) cout << "batched bin_search FAILED\n";
+	cout << n << " ints: std::lower_bound " << std_ns << " ns, bin_search " << bin_ns << " ns (" << bin_found
+		<< " found), Eytzinger " << eyt_ns << " ns, batched bin_search " << batch_ns << " ns per lookup\n";
+}
+
+// ns per lookup of keys drawn from the data, and the index's size, for uniform and lognormal 64 bit keys
+void profile_learned_index(size_t n) {
+	mt19937_64 engine {1};
+	for (string dist : {"uniform", "lognormal"}) {
+		vector<long long> vals(n);
+		uniform_int_distribution<long long> uniform {0, 1LL << 50};
+		lognormal_distribution<double> lognormal {0, 2};
+		for (auto& v : vals) v = dist == "uniform" ? uniform(engine) : (long long)(lognormal(engine) * 1e9);
+		pdq_sort(begin(vals), end(vals));
+		const size_t lookups {1000000};
+		vector<long long> keys(lookups);
+		uniform_int_distribution<size_t> pick {0, n - 1};
+		for (auto& k : keys) k = vals[pick(engine)] + (pick(engine) & 1);	// about half present
+
+		size_t std_sum {0}, bin_found {0}, learned_sum {0};
+		Timer time;
+		for (long long k : keys) std_sum += lower_bound(begin(vals), end(vals), k) - begin(vals);
+		double std_ns {time.tonow() * 1000.0 / lookups};
+		time.restart();
+		for (long long k : keys) bin_found += bin_search(begin(vals), end(vals), k) != end(vals);
+		double bin_ns {time.tonow() * 1000.0 / lookups};
+		time.restart();
+		Learned_index<long long> index {vals};
+		double build_ms {time.tonow() / 1000.0};
+		time.restart();
+		for (long long k : keys) learned_sum += index.lower_bound(k);
+		double learned_ns {time.tonow() * 1000.0 / lookups};
+		if (std_sum != learned_sum) cout << "Learned_index FAILED\n";
+		cout << n << ' ' << dist << ": std::lower_bound " << std_ns << " ns, bin_search " << bin_ns
+			<< " ns (" << bin_found << " found), Learned_index " << learned_ns << " ns per lookup; " << index.segments() << " segments, "
+			<< (double)index.bytes() / n << " bytes per key, built in " << build_ms << " ms\n";
+	}
+}
+
+// sorted sets of 10^7 ids against sets 1 to 1000 times smaller, vs std::set_intersection and the hashing intersection
+void profile_intersect(size_t n) {
+	mt19937 engine {1};
+	auto ids = [&engine](size_t count, int range) {
+		uniform_int_distribution<int> die {0, range};
+		vector<int> s(count);
+		for (auto& v : s) v = die(engine);
+		pdq_sort(begin(s), end(s));
+		s.erase(unique(begin(s), end(s)), end(s));
+		return s;
+	};
+	for (size_t ratio : {1, 10, 100, 1000}) {
+		vector<int> large {ids(n, 4 * n)}, small {ids(n / ratio, 4 * n)};
+		vector<int> out(small.size());
+		Timer time;
+		size_t std_found = set_intersection(begin(small), end(small), begin(large), end(large), begin(out)) - begin(out);
+		double std_ms {time.tonow() / 1000.0};
+		time.restart();
+		size_t found = intersect_sorted(begin(small), end(small), begin(large), end(large), begin(out)) - begin(out);
+		double sal_ms {time.tonow() / 1000.0};
+		time.restart();
+		size_t hashed {intersection(vector<vector<int>>{small, large}).size()};
+		double hash_ms {time.tonow() / 1000.0};
+		if (found != std_found || hashed != found) cout << "intersect_sorted FAILED\n";
+		cout << "1:" << ratio << " std::set_intersection " << std_ms << " ms, intersect_sorted " << sal_ms
+			<< " ms, intersection " << hash_ms << " ms\n";
+	}
+}
+
+void profile_multi_search(size_t bytes, size_t keywords) {
+	mt19937 engine {1};
+	uniform_int_distribution<int> letter {'a', 'z'}, length {4, 10};
+	auto word = [&]() {
+		string w(length(engine), ' ');
+		for (char& c : w) c = letter(engine);
+		return w;
+	};
+	// log-like text: words from a vocabulary, half the keywords from it and half (mostly) absent
+	vector<string> vocabulary(keywords * 10);
+	for (auto& w : vocabulary) w = word();
+	vector<string> patterns(begin(vocabulary), begin(vocabulary) + keywords / 2);
+	while (patterns.size() < keywords) patterns.push_back(word());
+	uniform_int_distribution<size_t> pick {0, vocabulary.size() - 1};
+	string text;
+	while (text.size() < bytes) text += vocabulary[pick(engine)] + (pick(engine) % 8 ? " " : "\n");
+
+	Timer time;
+	size_t first_found {0};
+	for (const auto& p : patterns) first_found += sub_match(text, p) != text.end();
+	double kmp_ms {time.tonow() / 1000.0};
+	time.restart();
+	size_t std_found {0};
+	for (const auto& p : patterns)
+		for (size_t i = text.find(p); i != string::npos; i = text.find(p, i + 1)) ++std_found;
+	double std_ms {time.tonow() / 1000.0};
+	time.restart();
+	Aho_corasick ac {patterns};
+	double build_ms {time.tonow() / 1000.0};
+	time.restart();
+	size_t found {ac.find_all(text).size()};
+	double ac_ms {time.tonow() / 1000.0};
+	if (found != std_found) cout << "Aho_corasick FAILED\n";
+	cout << keywords << " keywords in " << text.size() << " bytes: sub_match each (first only) " << kmp_ms
+		<< " ms (" << first_found << " found), string::find all " << std_ms << " ms, Aho_corasick " << ac_ms
+		<< " ms + " << build_ms << " ms to build (" << ac.states() << " states, " << ac.bytes() << " bytes), "
+		<< found << " matches\n";
+}
+
+void profile_substring_search(size_t bytes) {
+	// log-like text, lines of words and numbers
+	mt19937 engine {1};
+	uniform_int_distribution<int> letter {'a', 'z'}, length {2, 9}, digit {0, 9};
+	string text;
+	while (text.size() < bytes) {
+		for (int w = length(engine); w > 0; --w) text += static_cast<char>(letter(engine));
+		text += digit(engine) ? ' ' : '\n';
+		if (!digit(engine)) text += to_string(engine() % 100000) + ' ';
+	}
+	// searched for where they aren't, so every search covers the whole text
+	for (string pattern : {"#", "zq9k", "level=ERROR", "connection reset by peer", "abcdefghijklmnopqrstuvwxyz0123456789",
+		"the quick brown fox jumps over the lazy dog while the server restarts"}) {
+		String_searcher searcher {pattern};
+		Timer time;
+		bool kmp_found {sub_match(text, pattern) != text.end()};
+		double kmp_ms {time.tonow() / 1000.0};
+		time.restart();
+		size_t std_at {text.find(pattern)};
+		double std_ms {time.tonow() / 1000.0};
+		time.restart();
+		size_t at {searcher.find(text)};
+		double sal_ms {time.tonow() / 1000.0};
+		time.restart();
+		size_t matches {searcher.count(text)};
+		double count_ms {time.tonow() / 1000.0};
+		if (kmp_found != (at != text.size()) || (std_at == string::npos ? text.size() : std_at) != at)
+			cout << "String_searcher FAILED\n";
+		cout << pattern.size() << " byte pattern in " << text.size() / 1000000 << " MB: sub_match " << kmp_ms
+			<< " ms, string::find " << std_ms << " ms, String_searcher find " << sal_ms << " ms, count " << count_ms
+			<< " ms (" << matches << ")\n";
+	}
+	// repetitive text and pattern, where skipping can't help and KMP takes over
+	string as(bytes / 4, 'a');
+	String_searcher searcher {string(40, 'a') + 'b'};
+	Timer time;
+	size_t std_at {as.find(searcher.pattern())};
+	double std_ms {time.tonow() / 1000.0};
+	time.restart();
+	size_t at {searcher.find(as)};
+	double sal_ms {time.tonow() / 1000.0};
+	if ((std_at == string::npos ? as.size() : std_at) != at) cout << "String_searcher FAILED\n";
+	cout << "a^40 b in a^n: string::find " << std_ms << " ms, String_searcher " << sal_ms << " ms\n";
+}
+
+void profile_file_search(size_t bytes) {
+	const string path {"sal_search_profile.tmp"};
+	mt19937 engine {1};
+	uniform_int_distribution<int> letter {'a', 'z'};
+	{
+		string text(bytes, ' ');
+		for (size_t i = 0; i < bytes; ++i) if (i % 8) text[i] = static_cast<char>(letter(engine));
+		std::FILE* out {std::fopen(path.c_str(), "wb")};
+		std::fwrite(text.data(), 1, text.size(), out);
+		std::fclose(out);
+	}
+	const string pattern {"zq"};
+	Timer time;
+	string whole;
+	{
+		std::FILE* in {std::fopen(path.c_str(), "rb")};
+		whole.resize(bytes);
+		whole.resize(std::fread(&whole[0], 1, bytes, in));
+		std::fclose(in);
+	}
+	size_t loaded {String_searcher{pattern}.count(whole)};
+	double load_ms {time.tonow() / 1000.0};
+	whole = string{};
+	time.restart();
+	size_t mapped {count_file(path, pattern)};
+	double map_ms {time.tonow() / 1000.0};
+	time.restart();
+	size_t chunked {0};
+	Stream_searcher stream {pattern};
+	std::FILE* in {std::fopen(path.c_str(), "rb")};
+	for_each_chunk(in, [&](const char* begin, const char* end) { stream.feed(begin, end, [&chunked](size_t) { ++chunked; }); },
+		size_t{1} << 20);
+	std::fclose(in);
+	double chunk_ms {time.tonow() / 1000.0};
+	std::remove(path.c_str());
+	if (mapped != loaded || chunked != loaded) cout << "search_file FAILED\n";
+	cout << bytes / 1000000 << " MB file, " << loaded << " matches: read into a string and count " << load_ms
+		<< " ms, count_file (mmap) " << map_ms << " ms, 1 MB chunks through Stream_searcher " << chunk_ms << " ms\n";
+}
+
+string suffix_input(const string& kind, size_t n) {
+	mt19937 engine {1};
+	string text;
+	text.reserve(n);
+	if (kind == "dna") {
+		const char bases[] {"ACGT"};
+		uniform_int_distribution<int> base {0, 3};
+		while (text.size() < n) text += bases[base(engine)];
+	}
+	else {
+		// log lines from a small vocabulary, repetitive like real logs
+		vector<string> words(2000);
+		uniform_int_distribution<int> letter {'a', 'z'}, length {2, 9};
+		for (auto& w : words) for (int l = length(engine); l > 0; --l) w += static_cast<char>(letter(engine));
+		uniform_int_distribution<size_t> pick {0, words.size() - 1};
+		while (text.size() < n) text += words[pick(engine)] + (pick(engine) % 10 ? ' ' : '\n');
+		text.resize(n);
+	}
+	return text;
+}
+
+void profile_suffix_array(size_t n) {
+	for (string kind : {"dna", "log"}) {
+		const string text {suffix_input(kind, n)};
+		Timer time;
+		Suffix_array<> sa {text};
+		double ms {time.tonow() / 1000.0};
+		size_t longest {0};
+		for (size_t i = 0; i < sa.size(); ++i) longest = max(longest, sa.common_prefix_len(i));
+		cout << n << ' ' << kind << ": Suffix_array " << ms << " ms (" << ms * 1e6 / n << " ns per symbol), peak "
+			<< sa.build_bytes() / double(n) << " bytes per symbol, keeps " << sa.bytes() / double(n)
+			<< ", longest repeat " << longest << '\n';
+	}
+}
+
+void profile_par_suffix_array(size_t n) {
+	for (string kind : {"dna", "log"}) {
+		const string text {suffix_input(kind, n)};
+		Timer time;
+		Suffix_array<> reference {text};
+		cout << n << ' ' << kind << ": SA-IS " << time.tonow() / 1000.0 << " ms";
+		for (unsigned threads : {1u, 2u, 4u, 0u}) {
+			time.restart();
+			Suffix_array<> sa {text, threads};
+			const double ms {time.tonow() / 1000.0};
+			bool same {true};
+			for (size_t i = 0; i < sa.size() && same; ++i)
+				same = sa.suffix(i) == reference.suffix(i) && sa.common_prefix_len(i) == reference.common_prefix_len(i);
+			cout << ", " << (threads ? threads : thread::hardware_concurrency()) << " threads " << ms << " ms"
+				<< (same ? "" : " DIFFERENT");
+			if (threads == 1) cout << " (peak " << sa.build_bytes() / double(n) << " bytes per symbol)";
+		}
+		cout << '\n';
+	}
+}
+
 int main() {
 	// profile_prime_generation(test_size);	// 10^8
 
-	// std partition fastest; partition with < takes 1.1 more time, general partition 1.25 more time
+	// branchy Lomuto partition with < took 1.1x std partition time, general partition 1.25x
+	// block partition: < 0.3x, general 0.3x; with -mavx2 < 0.2x; with -mavx512f < 0.2x (2*10^7 ints)
 	profile_partition();
-}
\ No newline at end of file
+
+	// 10^7 ints, qck_sort (pdq) over std sort: random 0.45x, sorted 0.07x, reversed 0.12x,
+	// few unique 0.22x, organ pipe 0.37x, perturbed 0.68x; plain quick_sort 1.1x on random
+	// ints in chunks of 16, sorting network base case: qck_sort 0.18x std, tim_sort 0.25x, mer_sort 0.15x (AVX2);
+	// chunks of 1000 qck_sort 0.45x, tim_sort 0.75x
+	profile_qck_sort(10000000);
+	check_nan_sort();
+
+	// 10^7 ints (ms)  std    sal    qck    tim    mer    rdx    cnt    picked
+	// random          709    153    213    871    779    250    138    cnt_sort_inplace
+	// sorted          110    4.2    6.1    2.8    132    250    86     tim_sort
+	// reversed        77     9.7    13     6.3    142    278    84     tim_sort
+	// few unique      204    49     41     284    256    149    57     cnt_sort_inplace
+	// organ pipe      702    18     235    17     130    231    75     tim_sort
+	// perturbed       236    91     157    113    172    237    93     cnt_sort_inplace
+	profile_sal_sort(10000000);
+
+	// 10^7 (key, index) pairs over 1001 keys: std::stable_sort 1600 ms, mer_sort 1530,
+	// par_mer_sort on 4 threads 1567 (one core here)
+	profile_mer_sort(10000000);
+
+	// 10^7 pairs merged from k runs (ms)  std::stable_sort  multiway_merge  par_multiway_merge (4 threads, one core)
+	// 4 runs                             1014              86              93
+	// 64 runs                            1125              165             200
+	// 1024 runs                          967               775             850
+	profile_multiway_merge(10000000, 4);
+	profile_multiway_merge(10000000, 64);
+	profile_multiway_merge(10000000, 1024);
+
+	// 10^6 strings of 12 letters: random std::sort 415 ms, pat_sort 618;
+	// perturbed within 16 of sorted std::sort 223, pat_sort 579
+	profile_pat_sort(1000000);
+
+	// 10^7 uniform doubles, std::sort 1609 ms; bucket_sort with Bucket_pdq (16 per bucket) 711, Bucket_ins (4 per bucket)
+	// 661, Bucket_recursive over 1024 buckets 613; 4 threads on one core about the same
+	profile_bucket_sort(10000000);
+
+	// 10^7 ints over all of int, too wide to count so all pdq_sort: std::sort 1216 ms, cnt_sort 418,
+	// par_cnt_sort 414, cnt_sort_inplace 382; before the fallback the span overflowed int and aborted
+	profile_cnt_sort_span(10000000);
+
+	// 10^7 ints on disk (page cache), std::sort in memory 1282 ms; ext_sort with a 64 KB budget (916 runs):
+	// fan in 2 11 passes 2907 ms, fan in 64 3 passes 2647 ms; 4 MB (15 runs): fan in 2 5 passes 2053 ms, fan in 64 1974
+	profile_ext_sort(10000000);
+
+	// 10^7 ints, nth_select over std::nth_element, median / 99th percentile: random 0.11x / 0.08x,
+	// sorted 0.86x / 0.46x, reversed 0.94x / 0.42x, few unique 0.1x / 0.07x, organ pipe 0.07x / 0.03x;
+	// old quickselect on organ pipe was 1.5x / 2.2x; 4 percentiles with multi_select 0.02x of sorting
+	profile_select(10000000);
+
+	// 10^7 random keys without -mavx2 (AVX2 picked at run time), over std::minmax_element:
+	// int 0.08x, int64 0.46x (compare and blend, no 64 bit min), double 0.28x; sum 0.85x of accumulate
+	// the old scalar min_max read one past the end on odd sizes
+	profile_min_max(10000000);
+
+	// ns per lookup     std::lower_bound  bin_search  Eytzinger  batched bin_search (16 in flight)
+	// 10^3 ints         48                50          11         7.9
+	// 10^5 ints         89                93          28         12
+	// 10^7 ints         270               280         95         52
+	// 10^8 ints         494               521         216        131
+	for (size_t n : {1000, 100000, 10000000, 100000000}) profile_static_search(n);
+
+	// ns per lookup, 64 bit keys   std::lower_bound  bin_search  Learned_index (eps 32)  segments  bytes per key
+	// 10^7 uniform                 305               334         82                      3699      0.022
+	// 10^7 lognormal               308               332         159                     3668      0.022
+	// 10^8 uniform                 545               602         144                     36630     0.030
+	// 10^8 lognormal               533               590         248                     36585     0.019
+	// skewed keys crowd into a few radix table entries, leaving more segments to search
+	profile_learned_index(10000000);
+	profile_learned_index(100000000);
+
+	// 10^7 ids     std::set_intersection  intersect_sorted          intersection (hashing)
+	// 1:1          80 ms                  39 ms (SSE2 4x4 blocks)   5917 ms
+	// 1:10         14                     8.0                       2845
+	// 1:100        5.6                    4.3 (galloping)           2356
+	// 1:1000       4.8                    1.1                       2358
+	// 3 way with ids dense enough for bitmaps (16 per 64): 14 ms against 26 ms merging pairwise
+	profile_intersect(10000000);
+
+	// 10^7 bytes of words, half the keywords occur   sub_match each  string::find all  Aho_corasick  build
+	// 100 keywords (634 states, 73 KB)               1290 ms         661 ms            38 ms         0.2 ms
+	// 1000 keywords (5497 states, 630 KB)            12232           6552              60            1.2
+	// sub_match only finds the first of each, and scans the whole text for the absent ones
+	profile_multi_search(10000000, 100);
+	profile_multi_search(10000000, 1000);
+
+	// 256 MB of log-like text, absent patterns (ms)  sub_match  string::find  String_searcher
+	// 1 byte                                          431        25            25 (memchr)
+	// 4 bytes                                         705        175           40 (AVX2 rare pair)
+	// 11 bytes                                        577        165           35
+	// 24 bytes                                        638        189           45
+	// 36 bytes, all letters and digits                616        242           84 (its rarest pair, 89, is common)
+	// 69 bytes                                        802        170           42
+	// a^40 b in a^n                                              599           9.7 (b never shows up)
+	profile_substring_search(256000000);
+
+	// 1 GB file in the page cache, 1.1 million matches of a 2 byte pattern
+	// read into a string then String_searcher::count 1054 ms, count_file (mmap) 170 ms,
+	// 1 MB chunks with fread through Stream_searcher 223 ms
+	profile_file_search(1000000000);
+
+	// Suffix_array, SA-IS and Kasai's lcp with 32 bit indices, against the old prefix doubling with std::sort
+	// symbols         SA-IS (ms)  ns per symbol  peak bytes per symbol  prefix doubling (ms)
+	// 10^6 dna        118         118            12.0                   634
+	// 10^6 log        120         120            13.5                   629
+	// 10^7 dna        1925        192            12.0                   15940
+	// 10^7 log        1859        186            13.9                   17084
+	// 10^8 dna        32915       329            12.0                   276459
+	// 10^8 log        35456       355            13.5                   385084
+	// the peak is sa, lcp and the rank array for Kasai; SA-IS itself stays under it; prefix doubling held 24
+	profile_suffix_array(10000000);
+
+	// Suffix_array(text, threads), prefix doubling with parallel radix sorts and lcp, against SA-IS (ms)
+	// symbols    SA-IS   1 thread  2 threads  4 threads
+	// 10^6 dna   158     158       135        155
+	// 10^6 log   95      130       123        116
+	// 10^7 dna   1940    1704      1804       1780
+	// 10^7 log   1993    1909      2024       2234
+	// 10^8 dna   47107   28392     26984      28281
+	// 10^8 log   35804   32779     34871      33418
+	// on a single core, so the threads only show their overhead; peak 40 bytes per symbol (two 16 byte
+	// record arrays for the first radix sort) against SA-IS's 12
+	profile_par_suffix_array(10000000);
+}
@@ -61,6 +61,7 @@ enum Function_index {
     QCK_SORT,
     RDX_SORT,
     TIM_SORT,
+    SAL_SORT,
     SORT,
     LEVENSHTEIN,
     SA_LC_SUBSTRING,
@@ -106,6 +107,7 @@ const std::vector<pair<std::string, std::string>> names_in_order{
     {"qck_sort", "               quick sort"},
     {"rdx_sort", "               radix sort"},
     {"tim_sort", "               timsort"},
+    {"sal_sort", "               adaptive sort, picks a sort from a sample of the data"},
     {"sort", "               standard C++ library sort"},
 
     {"levenshtein", "WORD WORD      Levenshtein distance with dynamic programming"},
@@ -151,6 +153,7 @@ const std::map<std::string, Function_index> algonames{{"0", RANDGEN},
                                             {"qck_sort", QCK_SORT},
                                             {"rdx_sort", RDX_SORT},
                                             {"tim_sort", TIM_SORT},
+                                            {"sal_sort", SAL_SORT},
                                             {"sort", SORT},
 
                                             {"levenshtein", LEVENSHTEIN},
@@ -420,6 +423,7 @@ int algotest(std::vector<std::string> args) {
         case QCK_SORT:
         case RDX_SORT:
         case TIM_SORT:
+        case SAL_SORT:
         case SORT: {  // sorts
             load_data(vlist);
             int bit_num{static_cast<int>(ceil(log2(range)))};
@@ -452,11 +456,16 @@ int algotest(std::vector<std::string> args) {
                 case RDX_SORT:
                     for (auto& v : vlist) rdx_sort(v.begin(), v.end(), bit_num);
                     break;  // # bits is log2 of maximum value
-                case TIM_SORT:
-                    for (auto& v : vlist) tim_sort(v.begin(), v.end());
+                case TIM_SORT: {
+                    Timsort<std::vector<int>::iterator> sorter;
+                    for (auto& v : vlist) sorter(v.begin(), v.end());
+                    break;
+                }
+                case SAL_SORT:
+                    for (auto& v : vlist) sal::sort(v.begin(), v.end());
                     break;
                 case SORT:
-                    for (auto& v : vlist) sort(v.begin(), v.end());
+                    for (auto& v : vlist) std::sort(v.begin(), v.end());
                     break;
                 default:
                     break;
@@ -498,7 +507,7 @@ int algotest(std::vector<std::string> args) {
         }
         case EXPERIMENT: {  // testing for new algorithms
             std::vector<std::string> test{ftostr(fname)};
-            sort(test.begin(), test.end());
+            std::sort(test.begin(), test.end());
             if (to_print) print(test, out);
             break;
         }
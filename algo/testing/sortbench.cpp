@@ -0,0 +1,270 @@
+/* sort benchmark, every sal sort and std::sort over the standard input distributions
+
+g++ -std=c++11 -O3 -march=native -pthread sortbench.cpp -o sortbench
+
+sortbench [options]
+	-n 1000,100000,10000000		sizes to run
+	-t 7						trials per size, min and median are reported
+	-s sal_sort,qck_sort		only these sorts (names as printed)
+	-d random,zipfian			only these distributions
+	--seed 1					inputs are generated from this, the same seed gives the same inputs
+	--csv out.csv				also write results as CSV
+	--json out.json				also write results as JSON
+	--baseline old.csv			compare medians against a previous CSV run
+	--tolerance 1.1				median over baseline median above this is a regression, exit code 1
+
+every result is checked against one std::sort of the input, so dropped or duplicated keys count too;
+a sort that gets it wrong fails the run with exit code 2
+small sizes repeat the sort on fresh copies within a trial so each trial runs long enough to time
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>		// strtoul, strtod
+#include <fstream>
+#include <functional>	// less
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "../sort.h"
+
+using namespace std;
+using namespace sal;
+
+using Ints = vector<int>;
+using Strs = vector<string>;
+
+// a sort under test, either kind of input can be left out
+struct Bench_sort {
+	const char* name;
+	void (*ints)(Ints&);
+	void (*strs)(Strs&);
+	size_t max_n;	// quadratic sorts only run up to this size
+};
+
+constexpr size_t any_n {static_cast<size_t>(-1)};
+
+const vector<Bench_sort> sorts {
+	{"std_sort", [](Ints& v) { std::sort(v.begin(), v.end()); }, [](Strs& v) { std::sort(v.begin(), v.end()); }, any_n},
+	{"std_stable_sort", [](Ints& v) { std::stable_sort(v.begin(), v.end()); },
+		[](Strs& v) { std::stable_sort(v.begin(), v.end()); }, any_n},
+	{"sal_sort", [](Ints& v) { sal::sort(v.begin(), v.end()); }, [](Strs& v) { sal::sort(v.begin(), v.end()); }, any_n},
+	{"qck_sort", [](Ints& v) { qck_sort(v); }, [](Strs& v) { qck_sort(v); }, any_n},
+	{"tim_sort", [](Ints& v) { tim_sort(v); }, [](Strs& v) { tim_sort(v); }, any_n},
+	{"mer_sort", [](Ints& v) { mer_sort(v); }, [](Strs& v) { mer_sort(v); }, any_n},
+	{"par_mer_sort", [](Ints& v) { par_mer_sort(v.begin(), v.end()); },
+		[](Strs& v) { par_mer_sort(v.begin(), v.end()); }, any_n},
+	{"heap_sort", [](Ints& v) { heap_sort(v); }, [](Strs& v) { heap_sort(v); }, any_n},
+	{"pat_sort", [](Ints& v) { pat_sort(v.begin(), v.end()); }, [](Strs& v) { pat_sort(v.begin(), v.end()); }, any_n},
+	{"ins_sort", [](Ints& v) { ins_sort(v); }, [](Strs& v) { ins_sort(v); }, 1 << 14},
+	{"bub_sort", [](Ints& v) { bub_sort(v); }, [](Strs& v) { bub_sort(v); }, 1 << 12},
+	{"rdx_sort", [](Ints& v) { rdx_sort(v); }, [](Strs& v) { rdx_sort(v); }, any_n},
+	{"cnt_sort", [](Ints& v) { cnt_sort(v.begin(), v.end()); }, nullptr, any_n},
+	{"par_cnt_sort", [](Ints& v) { par_cnt_sort(v.begin(), v.end()); }, nullptr, any_n},
+	{"cnt_sort_inplace", [](Ints& v) { cnt_sort_inplace(v.begin(), v.end()); }, nullptr, any_n},
+	{"bucket_sort", [](Ints& v) {
+		if (!v.empty()) bucket_sort(v.begin(), v.end(), Number_bucket_hash(v.begin(), v.end(), max<size_t>(v.size() / 8, 1)));
+	}, nullptr, any_n},
+};
+
+const vector<string> dists {"random", "sorted", "reversed", "few_unique", "organ_pipe",
+	"sawtooth", "perturbed", "zipfian", "strings"};
+
+// inputs, all from the one seeded engine so runs compare
+class Inputs {
+	mt19937_64 engine;
+public:
+	explicit Inputs(unsigned long long seed) : engine(seed) {}
+
+	Ints ints(const string& dist, size_t n) {
+		Ints v(n);
+		for (size_t i = 0; i < n; ++i) v[i] = i;
+		if (dist == "random") shuffle(v.begin(), v.end(), engine);
+		else if (dist == "reversed") reverse(v.begin(), v.end());
+		else if (dist == "few_unique") {
+			uniform_int_distribution<int> die {0, 15};
+			for (auto& x : v) x = die(engine);
+		}
+		else if (dist == "organ_pipe") for (size_t i = n/2; i < n; ++i) v[i] = n - i;
+		// 16 ascending teeth
+		else if (dist == "sawtooth") for (size_t i = 0; i < n; ++i) v[i] = i % (n / 16 + 1);
+		// swaps at most 16 apart, same as utility's perturb
+		else if (dist == "perturbed") {
+			uniform_int_distribution<long long> die {-16, 16};
+			for (long long i = 0; i < (long long)n; ++i) {
+				long long j {i + die(engine)};
+				if (j >= 0 && j < (long long)n) swap(v[i], v[j]);
+			}
+		}
+		// rank k drawn with probability proportional to 1/k, so a few keys dominate
+		else if (dist == "zipfian") {
+			vector<double> cdf(n);
+			double total {0};
+			for (size_t k = 0; k < n; ++k) cdf[k] = total += 1.0 / (k + 1);
+			uniform_real_distribution<double> die {0, total};
+			for (auto& x : v) x = lower_bound(cdf.begin(), cdf.end(), die(engine)) - cdf.begin();
+			shuffle(v.begin(), v.end(), engine);
+		}
+		return v;	// sorted
+	}
+
+	// lowercase words of 1 to 16 letters, lengths and letters uniform
+	Strs strs(size_t n) {
+		uniform_int_distribution<int> len {1, 16}, letter {'a', 'z'};
+		Strs v(n);
+		for (auto& s : v) {
+			s.resize(len(engine));
+			for (auto& c : s) c = letter(engine);
+		}
+		return v;
+	}
+};
+
+struct Result {
+	string sort, dist;
+	size_t n, trials;
+	double min_ms, median_ms;
+};
+
+// min and median ms per sort over trials, each trial sorting copies enough times to be timeable
+// false if any copy doesn't come out equal to expected (the input sorted once by std::sort)
+template <typename T>
+bool time_sort(void (*sorter)(vector<T>&), const vector<T>& input, const vector<T>& expected, size_t trials,
+			   double& min_ms, double& median_ms) {
+	const size_t reps {max<size_t>(1, (1 << 16) / max<size_t>(input.size(), 1))};
+	vector<double> samples;
+	for (size_t t = 0; t < trials; ++t) {
+		vector<vector<T>> copies(reps, input);
+		auto start = chrono::steady_clock::now();
+		for (auto& c : copies) sorter(c);
+		samples.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / reps);
+		for (auto& c : copies) if (c != expected) return false;
+	}
+	std::sort(samples.begin(), samples.end());
+	min_ms = samples.front();
+	median_ms = samples.size() % 2 ? samples[samples.size() / 2] :
+		(samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2;
+	return true;
+}
+
+vector<string> split(const string& s, char sep = ',') {
+	vector<string> parts;
+	istringstream is {s};
+	for (string part; getline(is, part, sep);) if (!part.empty()) parts.push_back(part);
+	return parts;
+}
+
+bool selected(const vector<string>& only, const string& name) {
+	return only.empty() || find(only.begin(), only.end(), name) != only.end();
+}
+
+void write_csv(const string& path, const vector<Result>& results) {
+	ofstream f {path};
+	f << "sort,dist,n,trials,min_ms,median_ms\n";
+	for (const auto& r : results)
+		f << r.sort << ',' << r.dist << ',' << r.n << ',' << r.trials << ',' << r.min_ms << ',' << r.median_ms << '\n';
+}
+
+void write_json(const string& path, const vector<Result>& results) {
+	ofstream f {path};
+	f << "[\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const auto& r = results[i];
+		f << "  {\"sort\": \"" << r.sort << "\", \"dist\": \"" << r.dist << "\", \"n\": " << r.n
+			<< ", \"trials\": " << r.trials << ", \"min_ms\": " << r.min_ms << ", \"median_ms\": " << r.median_ms
+			<< (i + 1 < results.size() ? "},\n" : "}\n");
+	}
+	f << "]\n";
+}
+
+// (sort, dist, n) -> median ms from a previous CSV run
+map<tuple<string, string, size_t>, double> read_csv(const string& path) {
+	map<tuple<string, string, size_t>, double> medians;
+	ifstream f {path};
+	if (!f) cerr << "can't read baseline " << path << '\n';
+	string line;
+	getline(f, line);	// header
+	while (getline(f, line)) {
+		auto cols = split(line);
+		if (cols.size() < 6) continue;
+		medians[make_tuple(cols[0], cols[1], strtoul(cols[2].c_str(), nullptr, 10))] = strtod(cols[5].c_str(), nullptr);
+	}
+	return medians;
+}
+
+int main(int argc, char* argv[]) {
+	vector<size_t> sizes {1000, 100000, 10000000};
+	size_t trials {7};
+	vector<string> only_sorts, only_dists;
+	unsigned long long seed {1};
+	string csv, json, baseline;
+	double tolerance {1.1};
+
+	for (int a = 1; a < argc; ++a) {
+		string opt {argv[a]};
+		if (a + 1 == argc) { cerr << "missing value for " << opt << '\n'; return 3; }
+		string val {argv[++a]};
+		if (opt == "-n") {
+			sizes.clear();
+			for (const auto& s : split(val)) sizes.push_back(strtoul(s.c_str(), nullptr, 10));
+		}
+		else if (opt == "-t") trials = max<size_t>(1, strtoul(val.c_str(), nullptr, 10));
+		else if (opt == "-s") only_sorts = split(val);
+		else if (opt == "-d") only_dists = split(val);
+		else if (opt == "--seed") seed = strtoull(val.c_str(), nullptr, 10);
+		else if (opt == "--csv") csv = val;
+		else if (opt == "--json") json = val;
+		else if (opt == "--baseline") baseline = val;
+		else if (opt == "--tolerance") tolerance = strtod(val.c_str(), nullptr);
+		else { cerr << "unknown option " << opt << '\n'; return 3; }
+	}
+
+	auto base = baseline.empty() ? decltype(read_csv("")){} : read_csv(baseline);
+	vector<Result> results;
+	bool wrong {false}, regressed {false};
+	Inputs inputs {seed};
+
+	cout << "sort\tdist\tn\tmin_ms\tmedian_ms" << (base.empty() ? "" : "\tvs_baseline") << '\n';
+	for (size_t n : sizes) {
+		for (const auto& dist : dists) {
+			if (!selected(only_dists, dist)) continue;
+			const bool strings {dist == "strings"};
+			Ints ints;
+			Strs strs;
+			if (strings) strs = inputs.strs(n);
+			else ints = inputs.ints(dist, n);
+			Ints sorted_ints {ints};
+			Strs sorted_strs {strs};
+			std::sort(sorted_ints.begin(), sorted_ints.end());
+			std::sort(sorted_strs.begin(), sorted_strs.end());
+
+			for (const auto& s : sorts) {
+				if (!selected(only_sorts, s.name) || n > s.max_n || (strings ? !s.strs : !s.ints)) continue;
+				Result r {s.name, dist, n, trials, 0, 0};
+				bool ok {strings ? time_sort(s.strs, strs, sorted_strs, trials, r.min_ms, r.median_ms) :
+					time_sort(s.ints, ints, sorted_ints, trials, r.min_ms, r.median_ms)};
+				if (!ok) {
+					cout << s.name << '\t' << dist << '\t' << n << "\tnot sorted or keys lost\n";
+					wrong = true;
+					continue;
+				}
+				cout << r.sort << '\t' << r.dist << '\t' << r.n << '\t' << r.min_ms << '\t' << r.median_ms;
+				auto old = base.find(make_tuple(r.sort, r.dist, r.n));
+				if (old != base.end() && old->second > 0) {
+					double ratio {r.median_ms / old->second};
+					cout << '\t' << ratio << 'x' << (ratio > tolerance ? " regression" : "");
+					regressed |= ratio > tolerance;
+				}
+				cout << endl;
+				results.push_back(r);
+			}
+		}
+	}
+
+	if (!csv.empty()) write_csv(csv, results);
+	if (!json.empty()) write_json(json, results);
+	return wrong ? 2 : regressed ? 1 : 0;
+}
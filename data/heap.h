@@ -151,20 +151,25 @@ public:
 
 	// gets top while inserting a new element, same complexity as extracting top
 	T replace_top(T&& new_elem) {
-		if (empty()) {elems.emplace_back(new_elem); return SENTINEL(T);}
-		T top {elems[1]};
+		if (empty()) {elems.emplace_back(std::move(new_elem)); return SENTINEL(T);}
+		T top {std::move(elems[1])};
 
 		size_t hole {1};
 		size_t child {2};
 		while (child+1 < elems.size()) {
 			if (cmp(elems[child + 1], elems[child])) 
 				++child;
-			elems[hole] = elems[child];
+			elems[hole] = std::move(elems[child]);
 			hole = child;
 			child = left(child);
 		}
+		// an only child (last element) still has to move up so the hole is a leaf
+		if (child < elems.size()) {
+			elems[hole] = std::move(elems[child]);
+			hole = child;
+		}
 		// replace hole with new element
-		sift_up(hole, new_elem);
+		sift_up(hole, std::move(new_elem));
 		return top;
 	}
 
@@ -174,7 +179,7 @@ public:
 	// O(lgn)
 	void insert(T key) {
 		elems.emplace_back();
-		sift_up(elems.size()-1, key);
+		sift_up(elems.size()-1, std::move(key));
 	}
 	// O(n) like constructor for all elements
 	template <typename Iter>
@@ -185,7 +190,7 @@ public:
 
 	// only for direct changes; for indirect changes, have to know whether to sift up or down
 	void increase_key(size_t i, const T& changed) {
-		sift_up(i, changed);	// move closer to root
+		sift_up(i, T(changed));	// move closer to root
 	}
 	void decrease_key(size_t i, const T& changed) {
 		elems[i] = changed;
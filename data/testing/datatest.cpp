@@ -1,10 +1,13 @@
 #include <algorithm>
 #include <iostream>
 #include <list>
+#include <random>
 #include <string>
 #include "../../algo/macros.h"
 #include "../matrix.h"
 #include "../heap.h"
+#include "../../algo/search/element_select.h"
+#include "../../algo/search/quantile_sketch.h"
 #include "../tree.h"
 #include "../list.h"
 #include "../interval.h"
@@ -111,6 +114,40 @@ void test_heap(bool print) {
 	cout << endl;
 }
 
+// sketches over shards merged, cross checked against exact selection
+void test_quantile_sketch(bool print) {
+	std::mt19937 rng {7};
+	const size_t n {200000}, shards {4}, k {200};
+	std::vector<int> vals;
+	std::vector<sal::Kll_sketch<int>> sketches(shards, sal::Kll_sketch<int>{k});
+	std::vector<sal::Top_k<int>> tops(shards, sal::Top_k<int>{20});
+	for (size_t i = 0; i < n; ++i) {
+		vals.push_back(rng() % 1000000);
+		sketches[i % shards].insert(vals.back());
+		tops[i % shards].push(vals.back());
+	}
+	for (size_t s = 1; s < shards; ++s) { sketches[0].merge(sketches[s]); tops[0].merge(tops[s]); }
+	const auto& sketch = sketches[0];
+	if (sketch.size() != n) cout << "FAILED...Kll_sketch merged size\n";
+
+	for (double q : {0.01, 0.1, 0.5, 0.9, 0.99, 0.999}) {
+		int estimate {sketch.quantile(q)};
+		std::vector<int> temp {vals};
+		int exact {*sal::select(temp.begin(), temp.end(), static_cast<size_t>(q * n) + 1)};
+		// rank error should stay within a few times 1/k
+		size_t below = std::count_if(vals.begin(), vals.end(), [estimate](int v) { return v < estimate; });
+		double err {std::abs(static_cast<double>(below) - q * n) / n};
+		if (print) cout << q << " quantile " << estimate << " exact " << exact << " rank error " << err << '\n';
+		if (err > 2.0 / k) cout << "FAILED...Kll_sketch quantile " << q << '\n';
+	}
+	if (sketch.min() != *std::min_element(vals.begin(), vals.end()) || sketch.max() != *std::max_element(vals.begin(), vals.end()))
+		cout << "FAILED...Kll_sketch extremes\n";
+
+	auto top = tops[0].sorted();
+	sal::top_k(vals.begin(), vals.end(), 20, std::greater<int>());
+	if (top.size() != 20 || !std::equal(top.begin(), top.end(), vals.begin())) cout << "FAILED...Top_k merged\n";
+}
+
 void test_tree(bool print) {
 
 	using Node = sal::Basic_node<int>;
@@ -570,6 +607,7 @@ int main(int argc, char** argv) {
 	// give p or -p argument for printing out results
 	if (argc > 1 && (argv[1][0] == 'p' || argv[1][1] == 'p')) print = true; 
 	test_heap(print);
+	test_quantile_sketch(print);
 	test_tree(print);
 	test_order_tree(print);
 	test_interval_set(print);